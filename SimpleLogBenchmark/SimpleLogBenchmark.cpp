@@ -0,0 +1,296 @@
+// SimpleLogBenchmark.cpp : Measures the logger: The latency of LOG(INFO) << ... calls (p50, p99, p99.9, max)
+// and the throughput, from 1 up to N threads, for every combination of prefixes, message size, output and mode.
+// Usage: SimpleLogBenchmark [--threads N] [--messages M] [--flush every|never] [--format csv|json]
+// (--messages: Per thread. The results go to stdout, one row per run.)
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <latch>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../SimpleLogger/SimpleLogger.h"
+#ifndef _WIN32
+#include "../SimpleLogger/SimpleLogSinks.h"
+#endif
+
+
+#ifdef _WIN32
+static constexpr const char* kNullDevice{ "NUL" };
+#else
+static constexpr const char* kNullDevice{ "/dev/null" };
+#endif
+
+static constexpr const char* kBenchmarkFile{ "SimpleLogBenchmark.txt" };
+
+
+// Discards the messages: Measures the logger alone.
+class NullSink : public SimpleLogSink
+{
+public:
+    void Write(std::span<const std::string_view>) override
+    {
+    }
+};
+
+
+struct Options
+{
+    unsigned threads{ std::max(std::thread::hardware_concurrency(), 1u) };
+    size_t messages{ 20000 };
+    bool flush_every{ true };
+    bool json{ false };
+};
+
+
+struct Scenario
+{
+    const char* prefixes;
+    const char* message;
+    const char* output;
+    const char* mode;
+};
+
+
+struct Result
+{
+    Scenario scenario;
+    unsigned threads;
+    size_t messages;
+    double seconds;
+    int64_t p50;
+    int64_t p99;
+    int64_t p999;
+    int64_t max;
+};
+
+
+static void SetPrefixes(const std::string& prefixes)
+{
+    if (prefixes == "timestamp") {
+        SimpleLogger::SetPrefixList({ SimpleLogger::TimestampPrefix });
+    } else if (prefixes == "timestamp+thread") {
+        SimpleLogger::SetPrefixList({ SimpleLogger::TimestampPrefix, ThreadIdPrefix::Append<wchar_t> });
+    } else {
+        SimpleLogger::SetPrefixList({});
+    }
+}
+
+
+static void SetOutput(const std::string& output)
+{
+    if (output == "null-sink") {
+        SimpleLogger::SetSink(std::make_unique<NullSink>());
+    } else if (output == "null-device") {
+        SimpleLogger::SetOstream(std::make_unique<std::wofstream>(kNullDevice));
+    } else if (output == "file") {
+        SimpleLogger::SetOstream(std::make_unique<std::wofstream>(kBenchmarkFile, std::ios::trunc));
+#ifndef _WIN32
+    } else if (output == "file-fd-sink") {
+        std::remove(kBenchmarkFile);
+        SimpleLogger::SetSink(std::make_unique<FdSink>(kBenchmarkFile));
+#endif
+    }
+}
+
+
+static void Reset()
+{
+    SimpleLogger::DisableAsync();
+    SimpleLogger::SetSink(nullptr);
+    SimpleLogger::SetOstream(nullptr);
+    SimpleLogger::SetPrefixList({});
+}
+
+
+// The value at quantile q of the sorted latencies.
+static int64_t Percentile(const std::vector<int64_t>& sorted, double q)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+
+    const auto index{ static_cast<size_t>(q * static_cast<double>(sorted.size())) };
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+
+static Result Run(const Scenario& scenario, unsigned threads, const Options& options)
+{
+    SetPrefixes(scenario.prefixes);
+    SetOutput(scenario.output);
+    SimpleLogger::SetFlushPolicy({ .messages = options.flush_every ? size_t{ 1 } : size_t{ 0 } });
+
+    if (std::strcmp(scenario.mode, "async") == 0) {
+        SimpleLogger::EnableAsync();
+    }
+
+    const bool long_message{ std::strcmp(scenario.message, "long") == 0 };
+    const std::wstring text(long_message ? 200 : 8, L'x');
+
+    std::vector<std::vector<int64_t>> latencies(threads);
+    std::latch ready{ static_cast<std::ptrdiff_t>(threads) };
+    std::latch start{ 1 }; // (Counted down by this thread, after reading the clock: No message is logged before begin.)
+    std::vector<std::jthread> workers{};
+
+    for (unsigned t{ 0 }; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            auto& thread_latencies{ latencies[t] };
+            thread_latencies.reserve(options.messages);
+            ready.count_down();
+            start.wait();
+
+            for (size_t i{ 0 }; i < options.messages; ++i) {
+                const auto begin{ std::chrono::steady_clock::now() };
+                LOG(INFO) << text << L' ' << i << L' ' << 3.25;
+                const auto end{ std::chrono::steady_clock::now() };
+
+                thread_latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+            }
+        });
+    }
+
+    ready.wait();
+    const auto begin{ std::chrono::steady_clock::now() };
+    start.count_down();
+
+    workers.clear(); // (Joins.)
+    SimpleLogger::Flush(); // (Asynchronous mode: Until everything is written.)
+
+    const auto end{ std::chrono::steady_clock::now() };
+    Reset();
+
+    std::vector<int64_t> all{};
+    all.reserve(threads * options.messages);
+
+    for (const auto& thread_latencies : latencies) {
+        all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+
+    std::sort(all.begin(), all.end());
+
+    return { scenario, threads, threads * options.messages, std::chrono::duration<double>(end - begin).count(),
+        Percentile(all, 0.5), Percentile(all, 0.99), Percentile(all, 0.999), all.empty() ? 0 : all.back() };
+}
+
+
+static void Print(const Result& result, bool json, bool first)
+{
+    const double throughput{ result.seconds > 0 ? static_cast<double>(result.messages) / result.seconds : 0 };
+
+    if (json) {
+        std::printf("%s  {\"prefixes\": \"%s\", \"message\": \"%s\", \"output\": \"%s\", \"mode\": \"%s\", \"threads\": %u, "
+            "\"messages\": %zu, \"seconds\": %.6f, \"messages_per_second\": %.0f, "
+            "\"p50_ns\": %lld, \"p99_ns\": %lld, \"p999_ns\": %lld, \"max_ns\": %lld}",
+            first ? "" : ",\n", result.scenario.prefixes, result.scenario.message, result.scenario.output, result.scenario.mode,
+            result.threads, result.messages, result.seconds, throughput, static_cast<long long>(result.p50),
+            static_cast<long long>(result.p99), static_cast<long long>(result.p999), static_cast<long long>(result.max));
+    } else {
+        std::printf("%s,%s,%s,%s,%u,%zu,%.6f,%.0f,%lld,%lld,%lld,%lld\n",
+            result.scenario.prefixes, result.scenario.message, result.scenario.output, result.scenario.mode,
+            result.threads, result.messages, result.seconds, throughput, static_cast<long long>(result.p50),
+            static_cast<long long>(result.p99), static_cast<long long>(result.p999), static_cast<long long>(result.max));
+    }
+
+    std::fflush(stdout);
+}
+
+
+static Options ParseOptions(int argc, char* argv[])
+{
+    Options options{};
+
+    for (int i{ 1 }; i < argc; ++i) {
+        const std::string option{ argv[i] };
+
+        if (i + 1 >= argc) {
+            throw std::invalid_argument(option);
+        }
+
+        const std::string value{ argv[++i] };
+
+        if (option == "--threads") {
+            options.threads = static_cast<unsigned>(std::max(std::stoul(value), 1ul));
+        } else if (option == "--messages") {
+            options.messages = std::stoul(value);
+        } else if (option == "--flush" && (value == "every" || value == "never")) {
+            options.flush_every = value == "every";
+        } else if (option == "--format" && (value == "csv" || value == "json")) {
+            options.json = value == "json";
+        } else {
+            throw std::invalid_argument(option + " " + value);
+        }
+    }
+
+    return options;
+}
+
+
+int main(int argc, char* argv[])
+{
+    Options options{};
+
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const std::exception&) {
+        std::cerr << "usage: SimpleLogBenchmark [--threads N] [--messages M] [--flush every|never] [--format csv|json]" << std::endl;
+        return 2;
+    }
+
+    std::vector<const char*> outputs{ "null-sink", "null-device", "file" };
+#ifndef _WIN32
+    outputs.push_back("file-fd-sink");
+#endif
+
+    // 1, 2, 4... up to the number of threads (and that number itself).
+    std::vector<unsigned> thread_counts{};
+
+    for (unsigned threads{ 1 }; threads < options.threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+
+    thread_counts.push_back(options.threads);
+
+    if (options.json) {
+        std::printf("[\n");
+    } else {
+        std::printf("prefixes,message,output,mode,threads,messages,seconds,messages_per_second,p50_ns,p99_ns,p999_ns,max_ns\n");
+    }
+
+    bool first{ true };
+
+    try {
+        for (const char* prefixes : { "none", "timestamp", "timestamp+thread" }) {
+            for (const char* message : { "short", "long" }) {
+                for (const char* output : outputs) {
+                    for (const char* mode : { "sync", "async" }) {
+                        for (const unsigned threads : thread_counts) {
+                            Print(Run({ prefixes, message, output, mode }, threads, options), options.json, first);
+                            first = false;
+                        }
+                    }
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "caught exception: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (options.json) {
+        std::printf("\n]\n");
+    }
+
+    std::remove(kBenchmarkFile);
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+// SimpleLogDecoder.cpp : Turns a binary log (see SimpleLogger::SetBinaryOstream) back into text.
+// Usage: SimpleLogDecoder <binary log> [<text log>] (Without an output file, the text goes to stdout.)
+// The text is written as UTF-8 (Wide string arguments are transcoded), whichever logger wrote the binary log.
+//
+
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+
+#include "../SimpleLogger/SimpleLogger.h"
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: SimpleLogDecoder <binary log> [<text log>]" << std::endl;
+        return 2;
+    }
+
+    try {
+        std::ifstream in_stream(argv[1], std::ios::binary);
+        if (!in_stream.good()) {
+            throw std::runtime_error("cannot open binary log");
+        }
+
+        if (argc == 3) {
+            std::ofstream out_stream(argv[2], std::ios::trunc | std::ios::binary);
+            if (!out_stream.good()) {
+                throw std::runtime_error("cannot open text log");
+            }
+            Utf8SimpleLogger::DecodeBinary(in_stream, out_stream);
+        } else {
+            Utf8SimpleLogger::DecodeBinary(in_stream, std::cout);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "caught exception: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,688 @@
+// SimpleLogTests.cpp : Checks of the logger's guarantees, that later changes must keep.
+// Returns 0 if all the checks pass (and prints the failed ones to stderr).
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+// Counts the heap allocations (all of them go through the replaceable operator new).
+// (GCC takes the std::free of memory from this operator new for a mismatch, once inlined.)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<size_t> allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* const memory{ std::malloc(size != 0 ? size : 1) }) {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+
+#include "../SimpleLogger/SimpleLogger.h"
+
+
+#ifdef _WIN32
+static constexpr const char* kNullDevice{ "NUL" };
+#else
+static constexpr const char* kNullDevice{ "/dev/null" };
+#endif
+
+static int failures{ 0 };
+
+
+static void Check(bool condition, const char* description)
+{
+    if (!condition) {
+        std::cerr << "FAILED: " << description << std::endl;
+        ++failures;
+    }
+}
+
+
+// Runs function; A hang is a failure too: Ends the process if it does not return within timeout.
+template <typename Function>
+static void WithinTimeout(std::chrono::seconds timeout, const char* description, Function function)
+{
+    auto done{ std::async(std::launch::async, function) };
+
+    if (done.wait_for(timeout) != std::future_status::ready) {
+        std::cerr << "FAILED (timed out): " << description << std::endl;
+        std::_Exit(1);
+    }
+}
+
+
+// Keeps the text written to it (Optionally slow: Sleeps in every Write). Owned by the logger: Valid until the sinks are reset.
+class MemorySink : public SimpleLogSink
+{
+public:
+
+    explicit MemorySink(std::chrono::microseconds delay = std::chrono::microseconds(0)) :
+        delay_(delay)
+    {
+    }
+
+
+    void Write(std::span<const std::string_view> messages) override
+    {
+        {
+            std::lock_guard lock(mutex_);
+
+            for (const auto message : messages) {
+                text_ += message;
+            }
+        }
+
+        if (delay_.count() > 0) {
+            std::this_thread::sleep_for(delay_);
+        }
+    }
+
+
+    void Flush() override
+    {
+        flushes_.fetch_add(1);
+    }
+
+
+    // The messages written so far (without the line breaks).
+    std::vector<std::string> Lines() const
+    {
+        std::lock_guard lock(mutex_);
+        std::vector<std::string> lines{};
+
+        for (size_t begin{ 0 }, end{ text_.find('\n') }; end != std::string::npos; begin = end + 1, end = text_.find('\n', begin)) {
+            lines.push_back(text_.substr(begin, end - begin));
+        }
+
+        return lines;
+    }
+
+
+    bool Contains(const std::string& line) const
+    {
+        const auto lines{ Lines() };
+
+        return std::find(lines.begin(), lines.end(), line) != lines.end();
+    }
+
+
+    size_t Flushes() const
+    {
+        return flushes_.load();
+    }
+
+private:
+
+    const std::chrono::microseconds delay_;
+    mutable std::mutex mutex_{};
+    std::string text_{};
+    std::atomic<size_t> flushes_{ 0 };
+};
+
+
+// Back to the defaults (synchronous, no sinks, no prefixes), between checks.
+static void Reset()
+{
+    SimpleLogger::DisableAsync();
+    SimpleLogger::SetDeferredFormatting(false);
+    SimpleLogger::SetBackpressure({});
+    SimpleLogger::SetFlushPolicy({});
+    SimpleLogger::SetSink(nullptr);
+    SimpleLogger::SetOstream(nullptr);
+    SimpleLogger::SetPrefixList({});
+}
+
+
+// Logs messages numbered messages ("#t i") from each of threads threads, concurrently.
+static void LogNumbered(int threads, int messages)
+{
+    std::vector<std::jthread> producers{};
+
+    for (int t{ 0 }; t < threads; ++t) {
+        producers.emplace_back([t, messages] {
+            for (int i{ 0 }; i < messages; ++i) {
+                LOG(INFO) << L"#" << t << L' ' << i;
+            }
+        });
+    }
+}
+
+
+// Each thread's numbered messages (see LogNumbered) were written once each, in the order they were logged.
+static bool WrittenInOrder(const MemorySink& memory, int threads, int messages)
+{
+    std::vector<int> next(threads, 0);
+
+    for (const auto& line : memory.Lines()) {
+        int t{ 0 };
+        int i{ 0 };
+
+        if (std::sscanf(line.c_str(), "INFO: #%d %d", &t, &i) != 2 || t < 0 || t >= threads || i != next[t]++) {
+            return false;
+        }
+    }
+
+    return std::all_of(next.begin(), next.end(), [messages](int count) { return count == messages; });
+}
+
+
+// Steady state (the thread's message buffer and the cached timestamp exist): A LOG statement allocates nothing.
+static void SynchronousLogDoesNotAllocate()
+{
+    SimpleLogger::SetOstream(std::make_unique<std::wofstream>(kNullDevice));
+
+    for (const bool timestamp : { false, true }) {
+        if (timestamp) {
+            SimpleLogger::SetPrefixList({ SimpleLogger::TimestampPrefix });
+        } else {
+            SimpleLogger::SetPrefixList({});
+        }
+
+        for (int i{ 0 }; i < 100; ++i) {
+            LOG(INFO) << L"x" << 42; // (Warm up.)
+        }
+
+        const size_t before{ allocations.load() };
+
+        for (int i{ 0 }; i < 10000; ++i) {
+            LOG(INFO) << L"x" << 42;
+        }
+
+        Check(allocations.load() == before, timestamp ? "LOG(INFO) << L\"x\" << 42 allocates (TimestampPrefix)" : "LOG(INFO) << L\"x\" << 42 allocates");
+    }
+
+    SimpleLogger::SetPrefixList({});
+    SimpleLogger::SetOstream(nullptr);
+}
+
+
+// Binary output of the UTF-8 logger (composed, and deferred, messages) decodes to the text it writes synchronously.
+static void Utf8BinaryRoundTrip()
+{
+    const std::string long_text(300, 'y');
+
+    const auto log{ [&long_text] {
+        LOG_UTF8(INFO) << "hello " << 42;
+        LOG_UTF8(WARNING) << long_text << ' ' << 3.5;
+    } };
+
+    auto text{ std::make_unique<std::ostringstream>() };
+    std::ostringstream* const text_stream{ text.get() };
+    Utf8SimpleLogger::SetPrefixList({});
+    Utf8SimpleLogger::SetOstream(std::move(text));
+    log();
+    const std::string expected{ text_stream->str() };
+    Utf8SimpleLogger::SetOstream(nullptr);
+
+    for (const bool deferred : { false, true }) {
+        auto binary{ std::make_unique<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary) };
+        std::stringstream* const binary_stream{ binary.get() };
+
+        Utf8SimpleLogger::SetDeferredFormatting(deferred);
+        Utf8SimpleLogger::SetBinaryOstream(std::move(binary));
+        Utf8SimpleLogger::EnableAsync();
+        log();
+        Utf8SimpleLogger::DisableAsync();
+
+        std::ostringstream decoded{};
+
+        try {
+            Utf8SimpleLogger::DecodeBinary(*binary_stream, decoded);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        Utf8SimpleLogger::SetBinaryOstream(nullptr); // (Destroys binary_stream.)
+        Check(decoded.str() == expected, deferred ? "UTF-8 binary round trip (deferred)" : "UTF-8 binary round trip");
+    }
+
+    Utf8SimpleLogger::SetDeferredFormatting(false);
+}
+
+
+// Deferred formatting (wide logger): The writer thread formats the captured arguments (numbers, wide and narrow
+// strings, non-ASCII text, format manipulators) into the same text the calling thread would have, for the out stream
+// and for the sinks (UTF-8).
+static void DeferredRoundTrip()
+{
+    const auto log{ [] {
+        const std::wstring wide{ L"h\u00e9llo \u20ac \U0001F600" };
+        const std::string narrow{ "narrow" };
+        static const int anchor{ 0 }; // (The same address on every call.)
+
+        LOG(INFO) << wide << L' ' << narrow.c_str() << L' ' << std::wstring_view(wide).substr(0, 5);
+        LOG(WARNING) << -7 << L' ' << 123456789012345LL << L' ' << 4000000000U << L' ' << static_cast<short>(-3) << L' ' << L'x' << L' ' << true;
+        LOG(ERROR) << 3.5 << L' ' << 1.0f / 3 << L' ' << 2.0L << L' ' << std::setprecision(3) << 3.14159 << L' ' << std::setw(6) << std::setfill(L'0') << 42;
+        LOG(CRITICAL) << std::hex << 255 << L' ' << std::setbase(8) << 8 << L' ' << static_cast<const void*>(&anchor);
+        LOG(INFO) << std::wstring(300, L'y') << 1; // (Longer than the message buffer's inline capacity.)
+    } };
+
+    auto expected_text{ std::make_unique<std::wostringstream>() };
+    const std::wostringstream* const expected_stream{ expected_text.get() };
+    auto expected_sink{ std::make_unique<MemorySink>() };
+    const MemorySink* const expected_memory{ expected_sink.get() };
+    SimpleLogger::SetOstream(std::move(expected_text));
+    log();
+    const std::wstring expected{ expected_stream->str() };
+    SimpleLogger::SetOstream(nullptr); // (Destroys expected_stream.)
+    SimpleLogger::SetSink(std::move(expected_sink));
+    log();
+    const auto expected_lines{ expected_memory->Lines() };
+    SimpleLogger::SetSink(nullptr);
+
+    for (const bool sink : { false, true }) {
+        auto text{ std::make_unique<std::wostringstream>() };
+        const std::wostringstream* const text_stream{ text.get() };
+        auto memory_sink{ std::make_unique<MemorySink>() };
+        const MemorySink* const memory{ memory_sink.get() };
+
+        if (sink) {
+            SimpleLogger::SetSink(std::move(memory_sink));
+        } else {
+            SimpleLogger::SetOstream(std::move(text));
+        }
+
+        SimpleLogger::EnableAsync();
+        SimpleLogger::SetDeferredFormatting(true);
+        log();
+        SimpleLogger::DisableAsync();
+
+        if (sink) {
+            Check(memory->Lines() == expected_lines, "Deferred formatting: The sinks get the text of the calling thread's formatting");
+        } else {
+            Check(text_stream->str() == expected, "Deferred formatting: The out stream gets the text of the calling thread's formatting");
+        }
+
+        Reset();
+    }
+}
+
+
+#if defined(__cpp_lib_format)
+// LOG_FMT (and LOG_FMT_UTF8) formats as std::format does, and chains with operator<< (Synchronous and asynchronous mode,
+// composed and deferred).
+static void FormatStyle()
+{
+    const std::vector<std::string> expected{ "INFO: user 42 took 3.14 ms", "WARNING: 3 retries left (appended)", "ERROR: [   ab] h\xc3\xa9llo" };
+
+    for (const int mode : { 0, 1, 2 }) { // (Synchronous, asynchronous, deferred.)
+        auto sink{ std::make_unique<MemorySink>() };
+        const MemorySink* const memory{ sink.get() };
+        SimpleLogger::SetSink(std::move(sink));
+
+        if (mode > 0) {
+            SimpleLogger::EnableAsync();
+            SimpleLogger::SetDeferredFormatting(mode == 2);
+        }
+
+        LOG_FMT(INFO, L"user {} took {:.2f} ms", 42, 3.14159);
+        LOG_FMT(WARNING, L"{} retries left", 3) << L" (appended)";
+        LOG_FMT(ERROR, L"[{:>5}] {}", L"ab", std::wstring(L"h\u00e9llo"));
+        SimpleLogger::Flush();
+
+        Check(memory->Lines() == expected, "LOG_FMT: Formats as std::format");
+
+        Reset();
+    }
+
+    auto text{ std::make_unique<std::ostringstream>() };
+    const std::ostringstream* const text_stream{ text.get() };
+    Utf8SimpleLogger::SetOstream(std::move(text));
+    LOG_FMT_UTF8(INFO, "{:04} {}", 7, "h\xc3\xa9llo") << '!';
+    Check(text_stream->str() == "INFO: 0007 h\xc3\xa9llo!\n", "LOG_FMT_UTF8: Formats as std::format");
+    Utf8SimpleLogger::SetOstream(nullptr); // (Destroys text_stream.)
+}
+#endif
+
+
+// kShared: The queue (small, so it wraps around many times) takes the messages of several threads, and loses, repeats, or
+// reorders none of them.
+static void SharedQueue()
+{
+    auto sink{ std::make_unique<MemorySink>() };
+    const MemorySink* const memory{ sink.get() };
+    SimpleLogger::SetSink(std::move(sink));
+    SimpleLogger::SetFlushPolicy({ .messages = 0 });
+    SimpleLogger::EnableAsync(64, SimpleLogger::QueueMode::kShared);
+
+    LogNumbered(4, 20000);
+    SimpleLogger::Flush();
+    Check(WrittenInOrder(*memory, 4, 20000), "kShared: Every message written once, in each thread's order");
+
+    Reset();
+}
+
+
+// kPerThread: Every thread's ring (small) keeps its messages in order, and loses or repeats none; Also those left in the
+// ring of a thread that exited, and with new threads logging after those exited.
+static void PerThreadRings()
+{
+    SimpleLogger::SetFlushPolicy({ .messages = 0 });
+    SimpleLogger::EnableAsync(64, SimpleLogger::QueueMode::kPerThread);
+
+    for (int round{ 0 }; round < 3; ++round) {
+        auto sink{ std::make_unique<MemorySink>() };
+        const MemorySink* const memory{ sink.get() };
+        SimpleLogger::SetSink(std::move(sink));
+
+        LogNumbered(4, 20000); // (The threads exit before Flush.)
+        SimpleLogger::Flush();
+        Check(WrittenInOrder(*memory, 4, 20000), "kPerThread: Every message written once, in each thread's order (also after the thread exited)");
+    }
+
+    Reset();
+}
+
+
+// The setters (replacing the configuration while LOG statements read it) run concurrently with logging threads:
+// No message is lost, repeated or reordered (Synchronous and asynchronous mode).
+static void SettersWhileLogging()
+{
+    for (const bool async : { false, true }) {
+        auto sink{ std::make_unique<MemorySink>() };
+        const MemorySink* const memory{ sink.get() };
+        SimpleLogger::SetSink(std::move(sink));
+
+        if (async) {
+            SimpleLogger::EnableAsync(256);
+        }
+
+        std::atomic<bool> stop{ false };
+        std::jthread setter{ [&stop, async] {
+            for (int i{ 0 }; !stop.load(); ++i) {
+                SimpleLogger::SetPrefixList(i % 2 == 0 ? std::vector<SimpleLogger::PrefixAppender>{ [](std::wstring&) {} } : std::vector<SimpleLogger::PrefixAppender>{});
+                SimpleLogger::SetFlushPolicy({ .messages = static_cast<size_t>(i % 4) });
+                SimpleLogger::SetBackpressure({ .low = SimpleLogger::Backpressure::kBlock, .high = i % 2 == 0 ? SimpleLogger::Backpressure::kSpill : SimpleLogger::Backpressure::kBlock });
+                SimpleLogger::SetMinSeverity(SimpleLogger::Severity::kDebug);
+
+                if (async) {
+                    SimpleLogger::SetDeferredFormatting(i % 2 == 0);
+                }
+
+                std::this_thread::yield();
+            }
+        } };
+
+        LogNumbered(4, 5000);
+        stop.store(true);
+        setter.join();
+        SimpleLogger::Flush();
+        Check(WrittenInOrder(*memory, 4, 5000), async ? "Setters while logging: Every message written once, in order (asynchronous)" : "Setters while logging: Every message written once, in order");
+
+        Reset();
+    }
+}
+
+
+// AddSink: Every message goes to each sink whose min_severity lets it through, in order (Synchronous and asynchronous
+// mode, composed and deferred).
+static void SinkFanOut()
+{
+    const std::vector<std::string> all{ "DEBUG: d", "INFO: i", "WARNING: w", "ERROR: e", "CRITICAL: c" };
+
+    for (const int mode : { 0, 1, 2 }) { // (Synchronous, asynchronous, deferred.)
+        auto debug{ std::make_unique<MemorySink>() };
+        auto warning{ std::make_unique<MemorySink>() };
+        auto critical{ std::make_unique<MemorySink>() };
+        const MemorySink* const sinks[]{ debug.get(), warning.get(), critical.get() };
+        SimpleLogger::SetSink(std::move(debug));
+        SimpleLogger::AddSink(std::move(warning), SimpleLogger::Severity::kWarning);
+        SimpleLogger::AddSink(std::move(critical), SimpleLogger::Severity::kCritical);
+
+        if (mode > 0) {
+            SimpleLogger::EnableAsync();
+            SimpleLogger::SetDeferredFormatting(mode == 2);
+        }
+
+        LOG(DEBUG) << L"d";
+        LOG(INFO) << L"i";
+        LOG(WARNING) << L"w";
+        LOG(ERROR) << L"e";
+        LOG(CRITICAL) << L"c";
+        SimpleLogger::Flush();
+
+        Check(sinks[0]->Lines() == all, "AddSink: A kDebug sink gets every message");
+        Check(sinks[1]->Lines() == std::vector<std::string>(all.begin() + 2, all.end()), "AddSink: A kWarning sink gets WARNING and above");
+        Check(sinks[2]->Lines() == std::vector<std::string>(all.begin() + 4, all.end()), "AddSink: A kCritical sink gets CRITICAL only");
+
+        Reset();
+    }
+}
+
+
+// Flush() returns while other threads keep logging (it waits for what was logged before it), having written
+// what the calling thread logged before it.
+static void FlushUnderLoad()
+{
+    auto sink{ std::make_unique<MemorySink>(std::chrono::milliseconds(1)) };
+    const MemorySink* const memory{ sink.get() };
+    SimpleLogger::SetSink(std::move(sink));
+    SimpleLogger::EnableAsync(1024);
+    SimpleLogger::SetBackpressure({ .low = SimpleLogger::Backpressure::kDrop, .high = SimpleLogger::Backpressure::kSpill,
+        .severity = SimpleLogger::Severity::kWarning }); // (The producers' messages may be dropped, not the checked ones.)
+
+    std::atomic<bool> stop{ false };
+    std::vector<std::jthread> producers{};
+
+    for (int t{ 0 }; t < 2; ++t) {
+        producers.emplace_back([&stop] {
+            for (int i{ 0 }; !stop.load(); ++i) {
+                LOG(INFO) << L"load " << i;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    for (int i{ 0 }; i < 3; ++i) {
+        LOG(WARNING) << L"before flush " << i;
+        WithinTimeout(std::chrono::seconds(5), "Flush() while other threads keep logging", [] { SimpleLogger::Flush(); });
+        Check(memory->Contains("WARNING: before flush " + std::to_string(i)), "Flush() writes what was logged before it (under load)");
+    }
+
+    stop.store(true);
+    producers.clear(); // (Joins.)
+    Reset();
+}
+
+
+// The flush policy's conditions (counted by the sink's Flush calls): By message count, by severity, never, by interval
+// (Asynchronous mode: Also when no message follows).
+static void FlushPolicy()
+{
+    auto sink{ std::make_unique<MemorySink>() };
+    const MemorySink* const memory{ sink.get() };
+    SimpleLogger::SetSink(std::move(sink));
+
+    SimpleLogger::SetFlushPolicy({ .messages = 3 });
+
+    for (int i{ 0 }; i < 9; ++i) {
+        LOG(INFO) << L"count " << i;
+    }
+
+    Check(memory->Flushes() == 3, "FlushPolicy::messages: Every 3 messages");
+
+    SimpleLogger::SetFlushPolicy({ .messages = 0, .severity = SimpleLogger::Severity::kError });
+    size_t flushes{ memory->Flushes() };
+
+    for (int i{ 0 }; i < 5; ++i) {
+        LOG(WARNING) << L"below " << i;
+    }
+
+    Check(memory->Flushes() == flushes, "FlushPolicy::severity: Not below it");
+    LOG(ERROR) << L"at";
+    Check(memory->Flushes() == flushes + 1, "FlushPolicy::severity: At it");
+
+    SimpleLogger::SetFlushPolicy({ .messages = 0 });
+    flushes = memory->Flushes();
+
+    for (int i{ 0 }; i < 100; ++i) {
+        LOG(CRITICAL) << L"never " << i;
+    }
+
+    Check(memory->Flushes() == flushes, "FlushPolicy{ .messages = 0 }: Never");
+
+    SimpleLogger::SetFlushPolicy({ .messages = 0, .interval = std::chrono::milliseconds(100) });
+    LOG(INFO) << L"interval 1"; // (The first message after the policy was set: Longer than the interval since the last flush.)
+    flushes = memory->Flushes();
+    LOG(INFO) << L"interval 2";
+    Check(memory->Flushes() == flushes, "FlushPolicy::interval: Not within it");
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    LOG(INFO) << L"interval 3";
+    Check(memory->Flushes() == flushes + 1, "FlushPolicy::interval: On the first message after it");
+
+    SimpleLogger::EnableAsync();
+    SimpleLogger::Flush();
+    flushes = memory->Flushes();
+    LOG(INFO) << L"tail";
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    Check(memory->Flushes() > flushes && memory->Contains("INFO: tail"), "FlushPolicy::interval: The last message is flushed (asynchronous mode)");
+
+    Reset();
+}
+
+
+// A full queue (small, with a slow sink): Every message whose backpressure does not drop it is written, CRITICAL ones always
+// (also when its backpressure says kDrop), the dropped ones are counted, and each thread's messages keep their order
+// (also across spilled ones).
+static void Backpressure()
+{
+    using enum SimpleLogger::Backpressure;
+
+    struct Case
+    {
+        SimpleLogger::BackpressurePolicy policy;
+        SimpleLogger::QueueMode mode;
+        bool ordered; // (kOverwrite spills an evicted ERROR after the newer queued messages.)
+    };
+
+    const Case cases[]{
+        { { .low = kBlock, .high = kBlock }, SimpleLogger::QueueMode::kShared, true },
+        { { .low = kDrop, .high = kSpill }, SimpleLogger::QueueMode::kShared, true },
+        { { .low = kDrop, .high = kSpill }, SimpleLogger::QueueMode::kPerThread, true },
+        { { .low = kOverwrite, .high = kSpill }, SimpleLogger::QueueMode::kShared, false },
+        { { .low = kDrop, .high = kDrop, .severity = SimpleLogger::Severity::kCritical }, SimpleLogger::QueueMode::kShared, true },
+    };
+
+    constexpr int kThreads{ 3 };
+    constexpr int kMessages{ 3000 }; // (Per thread: INFO, ERROR and CRITICAL in turn.)
+
+    for (const Case& test_case : cases) {
+        auto sink{ std::make_unique<MemorySink>(std::chrono::microseconds(200)) };
+        const MemorySink* const memory{ sink.get() };
+        SimpleLogger::SetSink(std::move(sink));
+        SimpleLogger::SetFlushPolicy({ .messages = 0 });
+        SimpleLogger::EnableAsync(16, test_case.mode);
+        SimpleLogger::SetBackpressure(test_case.policy);
+        const uint64_t dropped_before{ SimpleLogger::GetStats().dropped_backpressure };
+
+        {
+            std::vector<std::jthread> producers{};
+
+            for (int t{ 0 }; t < kThreads; ++t) {
+                producers.emplace_back([t] {
+                    for (int i{ 0 }; i < kMessages; ++i) {
+                        switch (i % 3) {
+                        case 0: LOG(INFO) << L"#" << t << L' ' << i; break;
+                        case 1: LOG(ERROR) << L"#" << t << L' ' << i; break;
+                        default: LOG(CRITICAL) << L"#" << t << L' ' << i; break;
+                        }
+                    }
+                });
+            }
+        }
+
+        SimpleLogger::DisableAsync(); // (Writes what is queued.)
+        const uint64_t dropped{ SimpleLogger::GetStats().dropped_backpressure - dropped_before };
+
+        int last[kThreads]{ -1, -1, -1 };
+        int written[3]{}; // (By i % 3.)
+        bool ordered{ true };
+
+        for (const auto& line : memory->Lines()) {
+            int t{ 0 };
+            int i{ 0 };
+
+            if (std::sscanf(line.c_str() + line.find('#'), "#%d %d", &t, &i) != 2 || t < 0 || t >= kThreads) {
+                continue;
+            }
+
+            ordered = ordered && i > last[t];
+            last[t] = i;
+            ++written[i % 3];
+        }
+
+        const bool drops_error{ test_case.policy.high == kDrop };
+        const bool drops_info{ test_case.policy.low != kBlock };
+
+        Check(written[2] == kThreads * kMessages / 3, "Backpressure: CRITICAL messages are never dropped");
+        Check(drops_error || written[1] == kThreads * kMessages / 3, "Backpressure: Messages are dropped only by their own severity's backpressure");
+        Check(drops_info || written[0] == kThreads * kMessages / 3, "Backpressure: kBlock drops nothing");
+        Check(drops_info == (dropped > 0), "Backpressure: The queue was full (kDrop, kOverwrite drop messages)");
+        Check(static_cast<uint64_t>(written[0] + written[1] + written[2]) + dropped == kThreads * kMessages, "Backpressure: Dropped messages are counted");
+        Check(!test_case.ordered || ordered, "Backpressure: Each thread's messages keep their order (also spilled ones)");
+
+        Reset();
+    }
+}
+
+
+int main()
+{
+    SimpleLogger::SetPrefixList({});
+
+    SynchronousLogDoesNotAllocate();
+    Utf8BinaryRoundTrip();
+    DeferredRoundTrip();
+#if defined(__cpp_lib_format)
+    FormatStyle();
+#endif
+    SharedQueue();
+    PerThreadRings();
+    SettersWhileLogging();
+    SinkFanOut();
+    FlushUnderLoad();
+    FlushPolicy();
+    Backpressure();
+
+    if (failures == 0) {
+        std::cout << "All checks passed." << std::endl;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,1129 @@
+#ifndef AMITG_FC_SIMPLELOGSINKS
+#define AMITG_FC_SIMPLELOGSINKS
+
+/*
+  SimpleLogSinks.h
+  Copyright (c) 2024, Amit Gefen
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "SimpleLogger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ; // (Passed on to the compression process.)
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define SIMPLELOGSINKS_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+
+// Sinks: Outputs for the log text, instead of the out stream (see SimpleLogSink and SetSink):
+// SimpleLogger::SetSink(std::make_unique<WritevSink>("Log.txt"));
+// (POSIX only.)
+
+#ifndef _WIN32
+
+// A file descriptor, written completely (retrying on EINTR and on partial writes). Closed on destruction, if owned.
+// Errors throw std::system_error.
+class PosixFile
+{
+public:
+
+    // Opens path (Default: For appending; Created if needed).
+    explicit PosixFile(const char* path, int flags = O_WRONLY | O_CREAT | O_APPEND) :
+        fd_(::open(path, flags | O_CLOEXEC, 0644)), owned_(true)
+    {
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+    }
+
+
+    // Writes to fd (a file, a pipe, STDOUT_FILENO...), without taking ownership.
+    explicit PosixFile(int fd) noexcept : fd_(fd), owned_(false)
+    {
+    }
+
+
+    ~PosixFile()
+    {
+        if (owned_) {
+            ::close(fd_);
+        }
+    }
+
+
+    PosixFile(const PosixFile&) = delete;
+    PosixFile& operator=(const PosixFile&) = delete;
+
+
+    int Descriptor() const noexcept
+    {
+        return fd_;
+    }
+
+
+    // Writes the buffers iov[0, count). (Modifies iov, to resume after a partial write.)
+    void WriteAll(iovec* iov, int count)
+    {
+        while (count > 0) {
+            const ssize_t written{ ::writev(fd_, iov, count) };
+
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw std::system_error(errno, std::generic_category(), "writev");
+            }
+
+            // Skip the buffers written completely, and advance into the one written partially (if any).
+            auto remaining{ static_cast<size_t>(written) };
+
+            while (count > 0 && remaining >= iov->iov_len) {
+                remaining -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+
+            if (count > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+                iov->iov_len -= remaining;
+            }
+        }
+    }
+
+
+    void WriteAll(std::string_view bytes)
+    {
+        iovec iov{ const_cast<char*>(bytes.data()), bytes.size() };
+        WriteAll(&iov, 1);
+    }
+
+
+    // From a signal handler (see SimpleLogSink::CrashWrite): write(2) only. Errors are ignored.
+    void CrashWrite(std::string_view bytes) const noexcept
+    {
+        while (!bytes.empty()) {
+            const ssize_t written{ ::write(fd_, bytes.data(), bytes.size()) };
+
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                return;
+            }
+
+            bytes.remove_prefix(static_cast<size_t>(written));
+        }
+    }
+
+private:
+
+    const int fd_;
+    const bool owned_;
+};
+
+
+// Writes every batch of messages with a single writev(2), straight to a file descriptor: No stream, no locale,
+// no codecvt, and no copy (Every message is an iovec). In asynchronous mode, a burst of messages costs one
+// system call per batch (see kSinkBatchSize), instead of one per message.
+// A batch above IOV_MAX messages or kMaxWriteBytes is split. Nothing is buffered (Flush has nothing to do).
+class WritevSink : public SimpleLogSink
+{
+public:
+
+    // Bytes per writev (at most).
+    static constexpr size_t kMaxWriteBytes{ 1 << 20 };
+
+
+    explicit WritevSink(const char* path) : file_(path)
+    {
+        iov_.reserve(kMaxIov);
+    }
+
+
+    explicit WritevSink(int fd) : file_(fd)
+    {
+        iov_.reserve(kMaxIov);
+    }
+
+
+    void Write(std::span<const std::string_view> messages) override
+    {
+        iov_.clear(); // (Left over, if the previous write threw.)
+        size_t bytes{ 0 };
+
+        for (const auto& message : messages) {
+            if (iov_.size() == kMaxIov || (bytes > 0 && bytes + message.size() > kMaxWriteBytes)) {
+                Submit();
+                bytes = 0;
+            }
+
+            iov_.push_back({ const_cast<char*>(message.data()), message.size() });
+            bytes += message.size();
+        }
+
+        Submit();
+    }
+
+
+    void CrashWrite(std::span<const std::string_view> messages) noexcept override
+    {
+        for (const auto& message : messages) {
+            file_.CrashWrite(message);
+        }
+    }
+
+private:
+
+#ifdef IOV_MAX
+    static constexpr size_t kMaxIov{ IOV_MAX };
+#else
+    static constexpr size_t kMaxIov{ 1024 };
+#endif
+
+
+    void Submit()
+    {
+        if (!iov_.empty()) {
+            file_.WriteAll(iov_.data(), static_cast<int>(iov_.size()));
+            iov_.clear();
+        }
+    }
+
+
+    PosixFile file_;
+    std::vector<iovec> iov_{};
+};
+
+
+// Writes to a file descriptor through its own buffer (kDefaultBufferSize): The messages are copied into it,
+// and it is written (one write) when full and on Flush. No stream, no locale, no virtual call per character.
+// Suits synchronous mode too (with a flush policy that does not flush every message; see SetFlushPolicy).
+// A message larger than the buffer is written along with it, without copying. What is left is written on destruction.
+class FdSink : public SimpleLogSink
+{
+public:
+
+    static constexpr size_t kDefaultBufferSize{ 64 << 10 };
+
+
+    explicit FdSink(const char* path, size_t buffer_size = kDefaultBufferSize) : file_(path)
+    {
+        buffer_.reserve(buffer_size);
+    }
+
+
+    // Writes to fd (a file, a pipe, STDOUT_FILENO...), without taking ownership.
+    explicit FdSink(int fd, size_t buffer_size = kDefaultBufferSize) : file_(fd)
+    {
+        buffer_.reserve(buffer_size);
+    }
+
+
+    ~FdSink() override
+    {
+        try {
+            Flush();
+        } catch (const std::exception& e) {
+            std::cerr << "caught exception: " << e.what() << std::endl;
+        }
+    }
+
+
+    void Write(std::span<const std::string_view> messages) override
+    {
+        for (const auto& message : messages) {
+            if (buffer_.size() + message.size() <= buffer_.capacity()) {
+                buffer_.append(message); // (No allocation.)
+            } else if (message.size() <= buffer_.capacity()) {
+                Flush();
+                buffer_.append(message);
+            } else {
+                iovec iov[2]{ { buffer_.data(), buffer_.size() }, { const_cast<char*>(message.data()), message.size() } };
+                WriteBuffer(iov, 2);
+            }
+        }
+    }
+
+
+    void Flush() override
+    {
+        if (!buffer_.empty()) {
+            iovec iov{ buffer_.data(), buffer_.size() };
+            WriteBuffer(&iov, 1);
+        }
+    }
+
+
+    void CrashWrite(std::span<const std::string_view> messages) noexcept override
+    {
+        file_.CrashWrite(buffer_);
+        buffer_.clear(); // (Keeps the capacity: No deallocation.)
+
+        for (const auto& message : messages) {
+            file_.CrashWrite(message);
+        }
+    }
+
+private:
+
+    // Writes iov (the buffer, and possibly a message), then empties the buffer. (Also if the write fails: Dropped.)
+    void WriteBuffer(iovec* iov, int count)
+    {
+        try {
+            file_.WriteAll(iov, count);
+        } catch (...) {
+            buffer_.clear();
+            throw;
+        }
+
+        buffer_.clear();
+    }
+
+
+    PosixFile file_;
+    std::string buffer_{};
+};
+
+
+// Writes to a file through io_uring (Linux): The messages are copied into registered buffers, and a full
+// buffer is submitted as a write (to the registered file), while writing goes on into the next buffer. The
+// writer thread only waits when all the buffers are still being written. Flush submits the current buffer
+// (without waiting); The destructor waits for all the writes.
+// Falls back to an FdSink when io_uring is not available (older kernels, seccomp filters, other systems).
+class IoUringSink : public SimpleLogSink
+{
+public:
+
+    static constexpr size_t kDefaultBufferSize{ 256 << 10 };
+    static constexpr unsigned kDefaultBufferCount{ 4 };
+
+
+    // Appends to path (Created if needed).
+    explicit IoUringSink(const char* path, size_t buffer_size = kDefaultBufferSize, unsigned buffer_count = kDefaultBufferCount)
+    {
+#ifdef SIMPLELOGSINKS_HAS_IO_URING
+        try {
+            ring_ = std::make_unique<Ring>(path, std::max(buffer_size, size_t{ 1 }), std::max(buffer_count, 2u));
+            return;
+        } catch (const std::system_error&) {
+            // (Not available: Fall back.)
+        }
+#endif
+
+        fallback_ = std::make_unique<FdSink>(path, buffer_size);
+    }
+
+
+    bool UsesIoUring() const noexcept
+    {
+        return fallback_ == nullptr;
+    }
+
+
+    void Write(std::span<const std::string_view> messages) override
+    {
+        if (fallback_) {
+            fallback_->Write(messages);
+            return;
+        }
+
+#ifdef SIMPLELOGSINKS_HAS_IO_URING
+        ring_->Write(messages);
+#endif
+    }
+
+
+    void Flush() override
+    {
+        if (fallback_) {
+            fallback_->Flush();
+            return;
+        }
+
+#ifdef SIMPLELOGSINKS_HAS_IO_URING
+        ring_->Submit();
+#endif
+    }
+
+
+    void CrashWrite(std::span<const std::string_view> messages) noexcept override
+    {
+        if (fallback_) {
+            fallback_->CrashWrite(messages);
+            return;
+        }
+
+#ifdef SIMPLELOGSINKS_HAS_IO_URING
+        ring_->CrashWrite(messages);
+#endif
+    }
+
+private:
+
+#ifdef SIMPLELOGSINKS_HAS_IO_URING
+    // The ring (set up with the raw system calls: No liburing), the file and the buffers.
+    class Ring
+    {
+    public:
+
+        Ring(const char* path, size_t buffer_size, unsigned buffer_count) :
+            file_(path, O_WRONLY | O_CREAT), // (No O_APPEND: Every write has its own offset; Several may be in flight.)
+            buffer_size_(buffer_size),
+            memory_(std::make_unique<char[]>(buffer_size * buffer_count)),
+            buffers_(buffer_count)
+        {
+            struct stat status{};
+
+            if (::fstat(file_.Descriptor(), &status) != 0) {
+                throw std::system_error(errno, std::generic_category(), "fstat");
+            }
+
+            offset_ = static_cast<uint64_t>(status.st_size);
+
+            io_uring_params parameters{};
+            ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, buffer_count, &parameters));
+
+            if (ring_fd_ < 0) {
+                throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+            }
+
+            try {
+                MapRing(parameters);
+
+                std::vector<iovec> iov(buffer_count);
+
+                for (unsigned i{ 0 }; i < buffer_count; ++i) {
+                    buffers_[i].data = memory_.get() + i * buffer_size;
+                    iov[i] = { buffers_[i].data, buffer_size };
+                }
+
+                const int fd{ file_.Descriptor() };
+
+                if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iov.data(), buffer_count) != 0 ||
+                    ::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES, &fd, 1) != 0) {
+                    throw std::system_error(errno, std::generic_category(), "io_uring_register");
+                }
+            } catch (...) {
+                Unmap();
+                ::close(ring_fd_);
+                throw;
+            }
+        }
+
+
+        ~Ring()
+        {
+            try {
+                Submit();
+
+                while (in_flight_ > 0) {
+                    Reap(true);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "caught exception: " << e.what() << std::endl;
+            }
+
+            Unmap();
+            ::close(ring_fd_); // (Also unregisters the buffers and the file.)
+        }
+
+
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+
+
+        void Write(std::span<const std::string_view> messages)
+        {
+            for (auto message : messages) {
+                while (!message.empty()) {
+                    Buffer& buffer{ buffers_[current_] };
+
+                    if (buffer.in_flight) {
+                        Reap(true); // (All the buffers are being written.)
+                        continue;
+                    }
+
+                    if (buffer.size == buffer_size_) {
+                        Submit();
+                        continue;
+                    }
+
+                    const size_t count{ std::min(message.size(), buffer_size_ - buffer.size) };
+                    std::memcpy(buffer.data + buffer.size, message.data(), count);
+                    buffer.size += count;
+                    message.remove_prefix(count);
+                }
+            }
+
+            Reap(false); // (Retire the completed writes, and report errors, without waiting.)
+        }
+
+
+        // Submits the current buffer (if not empty, and not already submitted), and moves on to the next one.
+        void Submit()
+        {
+            Buffer& buffer{ buffers_[current_] };
+
+            if (buffer.size == 0 || buffer.in_flight) {
+                return;
+            }
+
+            const unsigned tail{ *sq_tail_ }; // (Only this thread produces.)
+            const unsigned index{ tail & *sq_mask_ };
+
+            io_uring_sqe& sqe{ sqes_[index] };
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_WRITE_FIXED;
+            sqe.flags = IOSQE_FIXED_FILE;
+            sqe.fd = 0; // (Index of the registered file.)
+            sqe.addr = reinterpret_cast<uint64_t>(buffer.data);
+            sqe.len = static_cast<uint32_t>(buffer.size);
+            sqe.off = offset_;
+            sqe.buf_index = static_cast<uint16_t>(current_);
+            sqe.user_data = current_;
+            sq_array_[index] = index;
+
+            std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+
+            buffer.offset = offset_;
+            buffer.in_flight = true;
+            offset_ += buffer.size;
+            ++in_flight_;
+
+            current_ = (current_ + 1) % static_cast<unsigned>(buffers_.size());
+
+            Enter(1, 0);
+        }
+
+
+        // From a signal handler: Writes the current buffer (unless submitted), then the messages, after the
+        // submitted writes, with write(2). (The submitted buffers are in the kernel's hands.)
+        void CrashWrite(std::span<const std::string_view> messages) noexcept
+        {
+            if (::lseek(file_.Descriptor(), static_cast<off_t>(offset_), SEEK_SET) < 0) {
+                return;
+            }
+
+            Buffer& buffer{ buffers_[current_] };
+
+            if (!buffer.in_flight) {
+                file_.CrashWrite({ buffer.data, buffer.size });
+                offset_ += buffer.size;
+                buffer.size = 0;
+            }
+
+            for (const auto& message : messages) {
+                file_.CrashWrite(message);
+                offset_ += message.size();
+            }
+        }
+
+    private:
+
+        struct Buffer
+        {
+            char* data{ nullptr };
+            size_t size{ 0 };
+            uint64_t offset{ 0 }; // (In the file.)
+            bool in_flight{ false };
+        };
+
+
+        void MapRing(const io_uring_params& parameters)
+        {
+            sq_size_ = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+            cq_size_ = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+            sqes_size_ = parameters.sq_entries * sizeof(io_uring_sqe);
+
+            const bool single_map{ (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0 };
+
+            if (single_map) {
+                sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+            }
+
+            sq_ring_ = MapOffset(sq_size_, IORING_OFF_SQ_RING);
+            cq_ring_ = single_map ? sq_ring_ : MapOffset(cq_size_, IORING_OFF_CQ_RING);
+            sqes_ = static_cast<io_uring_sqe*>(MapOffset(sqes_size_, IORING_OFF_SQES));
+
+            auto* const sq{ static_cast<char*>(sq_ring_) };
+            auto* const cq{ static_cast<char*>(cq_ring_) };
+
+            sq_tail_ = reinterpret_cast<unsigned*>(sq + parameters.sq_off.tail);
+            sq_mask_ = reinterpret_cast<unsigned*>(sq + parameters.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned*>(sq + parameters.sq_off.array);
+            cq_head_ = reinterpret_cast<unsigned*>(cq + parameters.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned*>(cq + parameters.cq_off.tail);
+            cq_mask_ = reinterpret_cast<unsigned*>(cq + parameters.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(cq + parameters.cq_off.cqes);
+        }
+
+
+        void* MapOffset(size_t size, off_t offset)
+        {
+            void* const mapping{ ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, offset) };
+
+            if (mapping == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "mmap");
+            }
+
+            return mapping;
+        }
+
+
+        void Unmap() noexcept
+        {
+            if (sqes_ != nullptr) {
+                ::munmap(sqes_, sqes_size_);
+            }
+
+            if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+                ::munmap(cq_ring_, cq_size_);
+            }
+
+            if (sq_ring_ != nullptr) {
+                ::munmap(sq_ring_, sq_size_);
+            }
+
+            sqes_ = nullptr;
+            cq_ring_ = sq_ring_ = nullptr;
+        }
+
+
+        void Enter(unsigned submit, unsigned wait)
+        {
+            while (::syscall(__NR_io_uring_enter, ring_fd_, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0) < 0) {
+                if (errno != EINTR) {
+                    throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+                }
+            }
+        }
+
+
+        // Retires the completed writes (wait: At least one). A short write is completed synchronously.
+        void Reap(bool wait)
+        {
+            if (wait) {
+                Enter(0, 1);
+            }
+
+            unsigned head{ *cq_head_ }; // (Only this thread consumes.)
+            const unsigned tail{ std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire) };
+            int error{ 0 };
+
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe{ cqes_[head & *cq_mask_] };
+                Buffer& buffer{ buffers_[cqe.user_data] };
+
+                if (cqe.res < 0) {
+                    error = -cqe.res;
+                } else if (static_cast<size_t>(cqe.res) < buffer.size) {
+                    error = WriteRest(buffer, static_cast<size_t>(cqe.res));
+                }
+
+                buffer.size = 0;
+                buffer.in_flight = false;
+                --in_flight_;
+            }
+
+            std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+
+            if (error != 0) {
+                throw std::system_error(error, std::generic_category(), "io_uring write");
+            }
+        }
+
+
+        int WriteRest(const Buffer& buffer, size_t written) noexcept
+        {
+            while (written < buffer.size) {
+                const ssize_t result{ ::pwrite(file_.Descriptor(), buffer.data + written, buffer.size - written,
+                    static_cast<off_t>(buffer.offset + written)) };
+
+                if (result < 0 && errno != EINTR) {
+                    return errno;
+                }
+
+                written += result > 0 ? static_cast<size_t>(result) : 0;
+            }
+
+            return 0;
+        }
+
+
+        PosixFile file_;
+        const size_t buffer_size_;
+        std::unique_ptr<char[]> memory_;
+        std::vector<Buffer> buffers_;
+        unsigned current_{ 0 };
+        unsigned in_flight_{ 0 };
+        uint64_t offset_{ 0 }; // (In the file, of the next write.)
+
+        int ring_fd_{ -1 };
+        void* sq_ring_{ nullptr };
+        void* cq_ring_{ nullptr };
+        io_uring_sqe* sqes_{ nullptr };
+        size_t sq_size_{ 0 };
+        size_t cq_size_{ 0 };
+        size_t sqes_size_{ 0 };
+        unsigned* sq_tail_{ nullptr };
+        unsigned* sq_mask_{ nullptr };
+        unsigned* sq_array_{ nullptr };
+        unsigned* cq_head_{ nullptr };
+        unsigned* cq_tail_{ nullptr };
+        unsigned* cq_mask_{ nullptr };
+        io_uring_cqe* cqes_{ nullptr };
+    };
+
+    std::unique_ptr<Ring> ring_{ nullptr };
+#endif
+
+    std::unique_ptr<FdSink> fallback_{ nullptr };
+};
+
+
+// Copies the messages into a shared memory mapping of the file: No system call per batch, only one per
+// segment (kDefaultSegmentSize). A segment is preallocated, mapped, filled, then the next one follows.
+// New messages are appended to an existing file. Flush schedules the write-back of the pages written
+// since the last flush (msync, MS_ASYNC); Readers of the file see the messages right away either way.
+// The preallocated tail is truncated on destruction. (The mapped pages belong to the kernel: What was
+// copied survives a crash of the process, followed by zero bytes up to the end of the segment.)
+class MmapSink : public SimpleLogSink
+{
+public:
+
+    static constexpr size_t kDefaultSegmentSize{ 64 << 20 };
+
+
+    // segment_size: Bytes mapped at a time (Rounded up to whole pages).
+    explicit MmapSink(const char* path, size_t segment_size = kDefaultSegmentSize) :
+        file_(path, O_RDWR | O_CREAT),
+        page_size_(static_cast<size_t>(::sysconf(_SC_PAGESIZE))),
+        segment_size_(std::max((segment_size + page_size_ - 1) / page_size_, size_t{ 1 }) * page_size_)
+    {
+        struct stat status{};
+
+        if (::fstat(file_.Descriptor(), &status) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat");
+        }
+
+        position_ = static_cast<size_t>(status.st_size);
+        flushed_ = position_;
+        Map(position_ - position_ % page_size_);
+    }
+
+
+    ~MmapSink() override
+    {
+        Unmap();
+        static_cast<void>(::ftruncate(file_.Descriptor(), static_cast<off_t>(position_))); // (Drop the preallocated tail.)
+    }
+
+
+    MmapSink(const MmapSink&) = delete;
+    MmapSink& operator=(const MmapSink&) = delete;
+
+
+    void Write(std::span<const std::string_view> messages) override
+    {
+        for (auto message : messages) {
+            while (!message.empty()) {
+                if (position_ == segment_offset_ + segment_size_) {
+                    Map(position_); // Next segment.
+                }
+
+                const size_t count{ std::min(message.size(), segment_offset_ + segment_size_ - position_) };
+                std::memcpy(mapping_ + (position_ - segment_offset_), message.data(), count);
+                position_ += count;
+                message.remove_prefix(count);
+            }
+        }
+    }
+
+
+    void Flush() override
+    {
+        const size_t begin{ std::max(flushed_, segment_offset_) / page_size_ * page_size_ };
+
+        if (mapping_ != nullptr && position_ > begin && ::msync(mapping_ + (begin - segment_offset_), position_ - begin, MS_ASYNC) != 0) {
+            throw std::system_error(errno, std::generic_category(), "msync");
+        }
+
+        flushed_ = position_;
+    }
+
+
+    // Copies into the mapped segment while it has room. Then truncates the preallocated tail (as the destructor
+    // would), and appends the rest with write(2); The mapping is not written to again, as it now extends past the file.
+    void CrashWrite(std::span<const std::string_view> messages) noexcept override
+    {
+        size_t i{ 0 };
+        std::string_view rest{};
+
+        for (; i < messages.size() && mapping_ != nullptr && !truncated_; ++i) {
+            const size_t count{ std::min(messages[i].size(), segment_offset_ + segment_size_ - position_) };
+            std::memcpy(mapping_ + (position_ - segment_offset_), messages[i].data(), count);
+            position_ += count;
+
+            if (count < messages[i].size()) {
+                rest = messages[i].substr(count);
+                ++i;
+                break;
+            }
+        }
+
+        if (!truncated_) {
+            static_cast<void>(::ftruncate(file_.Descriptor(), static_cast<off_t>(position_)));
+            truncated_ = true;
+        }
+
+        if ((rest.empty() && i == messages.size()) || ::lseek(file_.Descriptor(), static_cast<off_t>(position_), SEEK_SET) < 0) {
+            return;
+        }
+
+        file_.CrashWrite(rest);
+        position_ += rest.size();
+
+        for (; i < messages.size(); ++i) {
+            file_.CrashWrite(messages[i]);
+            position_ += messages[i].size();
+        }
+    }
+
+private:
+
+    // Maps the segment at offset (page aligned), preallocating it in the file.
+    void Map(size_t offset)
+    {
+        Unmap();
+
+        const auto end{ static_cast<off_t>(offset + segment_size_) };
+#if defined(__linux__)
+        const int error{ ::posix_fallocate(file_.Descriptor(), 0, end) }; // (Reserves the blocks: No surprise ENOSPC through the mapping.)
+#else
+        const int error{ ::ftruncate(file_.Descriptor(), end) != 0 ? errno : 0 };
+#endif
+
+        if (error != 0) {
+            throw std::system_error(error, std::generic_category(), "fallocate");
+        }
+
+        void* const mapping{ ::mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_.Descriptor(), static_cast<off_t>(offset)) };
+
+        if (mapping == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+
+        mapping_ = static_cast<char*>(mapping);
+        segment_offset_ = offset;
+    }
+
+
+    void Unmap() noexcept
+    {
+        if (mapping_ != nullptr) {
+            ::munmap(mapping_, segment_size_);
+            mapping_ = nullptr;
+        }
+    }
+
+
+    PosixFile file_;
+    const size_t page_size_;
+    const size_t segment_size_;
+
+    char* mapping_{ nullptr };
+    size_t segment_offset_{ 0 }; // (File offset of the mapping.)
+    size_t position_{ 0 }; // (File offset of the next byte.)
+    size_t flushed_{ 0 };
+    bool truncated_{ false }; // (By CrashWrite.)
+};
+
+
+// Writes to a file (as WritevSink does), and rotates it by size and/or time: The file is renamed to
+// path.<n> (n counts up, across runs), and a new file is started. A background thread then compresses
+// the rotated file (Default: gzip), and deletes the oldest ones beyond Rotation::generations: Writing
+// never waits for either. (Rotating renames the file: No message is lost, unlike with copy-truncate.)
+class RotatingFileSink : public SimpleLogSink
+{
+public:
+
+    // Compresses file into file.gz (gzip -f, run as a child process: gzip must be on the PATH).
+    // Throws std::system_error if gzip can not be run, or std::runtime_error if it fails (the file is then left as is).
+    static void Gzip(const std::string& file)
+    {
+        const char* const arguments[]{ "gzip", "-f", "--", file.c_str(), nullptr };
+        pid_t process{};
+
+        if (const int error{ ::posix_spawnp(&process, "gzip", nullptr, nullptr, const_cast<char* const*>(arguments), environ) }; error != 0) {
+            throw std::system_error(error, std::generic_category(), "gzip " + file);
+        }
+
+        int status{};
+
+        while (::waitpid(process, &status, 0) < 0) {
+            if (errno != EINTR) {
+                throw std::system_error(errno, std::generic_category(), "gzip " + file);
+            }
+        }
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) { // (127: The child could not run gzip.)
+            throw std::runtime_error("gzip " + file + (WIFEXITED(status) ? " exited with status " + std::to_string(WEXITSTATUS(status)) :
+                " was ended by signal " + std::to_string(WIFSIGNALED(status) ? WTERMSIG(status) : 0)));
+        }
+    }
+
+
+    struct Rotation
+    {
+        size_t max_size{ 0 }; // Rotate before the file would exceed this many bytes (0: Not by size).
+        std::chrono::seconds interval{ 0 }; // Rotate at every multiple of this since the epoch, e.g. every hour on the hour (UTC) (0: Not by time).
+        size_t generations{ 5 }; // Rotated files kept.
+        std::function<void(const std::string& file)> compress{ Gzip }; // Called on every rotated file, by the background thread (nullptr: Keep as is).
+    };
+
+
+    // Appends to path (Created if needed).
+    RotatingFileSink(std::string path, Rotation rotation) :
+        path_(std::move(path)),
+        rotation_(std::move(rotation)),
+        sequence_(LastSequence()),
+        worker_([this](std::stop_token stop_token) { Run(stop_token); })
+    {
+        Open();
+    }
+
+
+    void Write(std::span<const std::string_view> messages) override
+    {
+        if (file_ == nullptr) {
+            Open(); // (Failed after the last rotation.)
+        } else if (rotation_.interval.count() > 0 && std::chrono::system_clock::now() >= next_rotation_) {
+            Rotate();
+        }
+
+        size_t begin{ 0 };
+
+        for (size_t i{ 0 }; i < messages.size(); ++i) {
+            if (rotation_.max_size != 0 && size_ > 0 && size_ + messages[i].size() > rotation_.max_size) {
+                file_->Write(messages.subspan(begin, i - begin));
+                begin = i;
+                Rotate();
+            }
+
+            size_ += messages[i].size();
+        }
+
+        file_->Write(messages.subspan(begin));
+    }
+
+
+    // (No rotation: The messages go to the current file.)
+    void CrashWrite(std::span<const std::string_view> messages) noexcept override
+    {
+        if (file_ != nullptr) {
+            file_->CrashWrite(messages);
+        }
+    }
+
+private:
+
+    void Open()
+    {
+        file_ = std::make_unique<WritevSink>(path_.c_str());
+
+        std::error_code error{};
+        const auto size{ std::filesystem::file_size(path_, error) };
+        size_ = error ? 0 : static_cast<size_t>(size);
+
+        if (rotation_.interval.count() > 0) {
+            const auto now{ std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()) };
+            next_rotation_ = std::chrono::system_clock::time_point((now.time_since_epoch() / rotation_.interval + 1) * rotation_.interval);
+        }
+    }
+
+
+    void Rotate()
+    {
+        file_.reset(); // (Closes the file.)
+
+        std::string rotated{ path_ + '.' + std::to_string(++sequence_) };
+        std::error_code error{};
+        std::filesystem::rename(path_, rotated, error);
+
+        if (!error) {
+            std::lock_guard lock(mutex_);
+            pending_.push_back(std::move(rotated));
+            condition_.notify_one();
+        }
+
+        Open();
+    }
+
+
+    // The rotated files (path.<n>, compressed or not), by n.
+    std::vector<std::pair<size_t, std::filesystem::path>> RotatedFiles() const
+    {
+        const std::filesystem::path path{ path_ };
+        const std::string prefix{ path.filename().string() + '.' };
+        std::vector<std::pair<size_t, std::filesystem::path>> files{};
+        std::error_code error{};
+
+        for (const auto& entry : std::filesystem::directory_iterator(path.parent_path().empty() ? "." : path.parent_path(), error)) {
+            const std::string name{ entry.path().filename().string() };
+
+            if (name.starts_with(prefix) && name.size() > prefix.size() && std::isdigit(static_cast<unsigned char>(name[prefix.size()]))) {
+                files.emplace_back(std::stoull(name.substr(prefix.size())), entry.path());
+            }
+        }
+
+        return files;
+    }
+
+
+    size_t LastSequence() const
+    {
+        size_t sequence{ 0 };
+
+        for (const auto& [number, file] : RotatedFiles()) {
+            sequence = std::max(sequence, number);
+        }
+
+        return sequence;
+    }
+
+
+    // Deletes the rotated files beyond the newest generations. (Also those still pending: They are not compressed then.)
+    void Prune()
+    {
+        auto files{ RotatedFiles() };
+        std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        size_t kept{ 0 };
+        size_t last{ 0 };
+        std::vector<std::string> pruned{};
+
+        for (const auto& [number, file] : files) {
+            if (number != last) {
+                ++kept;
+                last = number;
+            }
+
+            if (kept > rotation_.generations) {
+                std::error_code error{};
+                std::filesystem::remove(file, error);
+                pruned.push_back(path_ + '.' + std::to_string(number)); // (As named by Rotate.)
+            }
+        }
+
+        if (!pruned.empty()) {
+            std::lock_guard lock(mutex_);
+            std::erase_if(pending_, [&pruned](const std::string& file) { return std::find(pruned.begin(), pruned.end(), file) != pruned.end(); });
+        }
+    }
+
+
+    // Background thread: Compresses and prunes after every rotation. (Finishes the pending ones when stopped.)
+    void Run(std::stop_token stop_token) noexcept
+    {
+        std::unique_lock lock(mutex_);
+
+        for (;;) {
+            condition_.wait(lock, stop_token, [this] { return !pending_.empty(); });
+
+            if (pending_.empty()) {
+                return;
+            }
+
+            const std::string file{ std::move(pending_.front()) };
+            pending_.pop_front();
+            lock.unlock();
+
+            try {
+                if (rotation_.compress) {
+                    rotation_.compress(file);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "caught exception: " << e.what() << std::endl; // (The file is kept uncompressed; Still pruned.)
+            }
+
+            try {
+                Prune();
+            } catch (const std::exception& e) {
+                std::cerr << "caught exception: " << e.what() << std::endl;
+            }
+
+            lock.lock();
+        }
+    }
+
+
+    const std::string path_;
+    const Rotation rotation_;
+
+    // (Writing thread only:)
+    std::unique_ptr<WritevSink> file_{ nullptr };
+    size_t size_{ 0 };
+    std::chrono::system_clock::time_point next_rotation_{};
+    size_t sequence_;
+
+    // The rotated files, waiting for the background thread:
+    std::deque<std::string> pending_{};
+    std::mutex mutex_{};
+    std::condition_variable_any condition_{};
+    std::jthread worker_; // (Last: Joined first, once the pending files are done.)
+};
+
+#endif // _WIN32
+
+#endif
\ No newline at end of file
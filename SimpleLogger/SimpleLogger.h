@@ -29,108 +29,416 @@
 #include <syncstream>
 #include <iostream>
 #include <array>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <source_location>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <cerrno>
+#include <signal.h>
+#include <unistd.h>
+#endif
+#if __has_include(<format>)
+#include <format>
+#endif
+
+
+// Compile-time minimum severity (0-4, or DEBUG...CRITICAL): LOG statements with a constant severity below it compile
+// to nothing (their arguments are not evaluated). Define it before including this header (or on the command line).
+#ifndef SIMPLELOGGER_MIN_SEVERITY
+#define SIMPLELOGGER_MIN_SEVERITY 0
+#endif
 
 
 // Macros for logging__
 
-#define LOG(severity) SimpleLogger(severity)
+#define LOG(severity) SIMPLELOGGER_LOG(SimpleLogger, severity)
+#define LOG_UTF8(severity) SIMPLELOGGER_LOG(Utf8SimpleLogger, severity) // (UTF-8 text, see BasicSimpleLogger.)
+
+// std::format style: LOG_FMT(INFO, L"user {} took {} ms", id, ms). The format string is checked at compile time.
+#if defined(__cpp_lib_format)
+#define LOG_FMT(severity, ...) SIMPLELOGGER_LOG(SimpleLogger, severity).Format(__VA_ARGS__)
+#define LOG_FMT_UTF8(severity, ...) SIMPLELOGGER_LOG(Utf8SimpleLogger, severity).Format(__VA_ARGS__)
+#endif
+
+// (The severity is evaluated once, and may be a runtime value. The if-else form keeps a dangling else bound to the caller's if.)
+// Below the minimum (see SIMPLELOGGER_MIN_SEVERITY, SetMinSeverity), the temporary is not constructed and the arguments
+// are not evaluated. (A constant severity below SIMPLELOGGER_MIN_SEVERITY: The optimizer removes the statement.)
+#define SIMPLELOGGER_LOG(logger, severity) \
+    if (const SimpleLoggerBase::Severity simplelogger_severity{ severity }; \
+        simplelogger_severity < SimpleLoggerBase::kMinSeverity || !SimpleLoggerBase::IsEnabled(simplelogger_severity)) {} \
+    else logger(simplelogger_severity)
 
 // Severities:
-#define DEBUG SimpleLogger::Severity::kDebug
-#define INFO SimpleLogger::Severity::kInfo
-#define WARNING SimpleLogger::Severity::kWarning
-#define ERROR SimpleLogger::Severity::kError
-#define CRITICAL SimpleLogger::Severity::kCritical
+#define DEBUG SimpleLoggerBase::Severity::kDebug
+#define INFO SimpleLoggerBase::Severity::kInfo
+#define WARNING SimpleLoggerBase::Severity::kWarning
+#define ERROR SimpleLoggerBase::Severity::kError
+#define CRITICAL SimpleLoggerBase::Severity::kCritical
 
 // __Macros for logging
 
 
+// The part of the logger that does not depend on the character type: The severities (shared by
+// SimpleLogger and Utf8SimpleLogger), and the runtime minimum severity (process-wide).
+
+class SimpleLoggerBase
+{
+public:
+
+    enum class Severity : uint8_t { kDebug, kInfo, kWarning, kError, kCritical }; // Bounds: 0-4.
+
+    // LOG statements with a constant severity below it are compiled out (see SIMPLELOGGER_MIN_SEVERITY).
+    static constexpr Severity kMinSeverity{ static_cast<Severity>(SIMPLELOGGER_MIN_SEVERITY) };
+
+    // Asynchronous mode queueing:
+    // kShared: One lock-free queue shared by all threads.
+    // kPerThread: Every logging thread gets its own single-producer ring (no writable cache line is shared between threads).
+    enum class QueueMode : uint8_t { kShared, kPerThread };
+
+    // Default capacity (in messages) of the asynchronous queue (kPerThread: Of every thread's ring).
+    static constexpr size_t kDefaultQueueCapacity{ 8192 };
+
+    // What a LOG statement does when the asynchronous queue (kPerThread: Its thread's ring) is full (see SetBackpressure).
+    // (The queue also counts as full while spilled messages wait in the overflow: A message never passes an older spilled one.)
+    enum class Backpressure : uint8_t {
+        kBlock, // Wait until the writer thread makes room (Default).
+        kDrop, // Drop the new message (counted, see GetStats).
+        kOverwrite, // Drop the oldest queued message, instead. (kPerThread: Only the writer thread takes from a ring: As kDrop.)
+                    // (If the oldest one's own backpressure does not drop it, it is spilled: Written after the queued messages.)
+        kSpill // Move the message to a growable overflow, which the writer thread takes after the queue.
+    };
+
+    // The backpressure for the messages below severity, and for those of severity and above.
+    struct BackpressurePolicy
+    {
+        Backpressure low{ Backpressure::kBlock };
+        Backpressure high{ Backpressure::kBlock };
+        Severity severity{ Severity::kError };
+    };
+
+    // When the out stream is flushed (see SetFlushPolicy). A flush is due when any of the set conditions holds.
+    // Default: After every message. Never flush (rely on the stream's buffer): { .messages = 0 }.
+    struct FlushPolicy
+    {
+        size_t messages{ 1 }; // After this many messages (0: Not by count).
+        std::chrono::milliseconds interval{ 0 }; // This long after the last flush (0: Not by time). (Synchronous mode: On the next message.)
+        std::optional<Severity> severity{}; // After any message of this severity or above.
+    };
+
+    // Latencies in nanoseconds, by power of two: Bucket i counts those in [2^(i-1), 2^i) (Bucket 0: Below 1 ns).
+    using LatencyHistogram = std::array<uint64_t, 40>;
+
+    // The logger's own counters (see GetStats): Totals since the start of the process.
+    struct Stats
+    {
+        std::array<uint64_t, 5> messages{}; // Messages logged, by severity.
+        uint64_t bytes{ 0 }; // Written: UTF-8 bytes to every sink, binary records, or characters to the out stream.
+        uint64_t dropped_backpressure{ 0 }; // Messages dropped by a full queue (see SetBackpressure).
+        uint64_t dropped_error{ 0 }; // Messages lost to errors (while composing or writing them), or for lack of an output.
+        uint64_t exceptions{ 0 }; // Exceptions caught (and reported to std::cerr).
+        uint64_t queue_high_water{ 0 }; // Asynchronous mode: Most messages queued, as found by the writer thread (kPerThread: In one ring).
+        LatencyHistogram enqueue_latency{}; // Handing a message over (Synchronous mode: Writing it). Sampled: One message in kLatencySampling, per thread.
+        LatencyHistogram flush_latency{}; // Flushing the output (see SetFlushPolicy).
+
+
+        // The upper bound (in nanoseconds) of the bucket that holds the quantile (0-1). 0 if empty.
+        static uint64_t Percentile(const LatencyHistogram& histogram, double quantile) noexcept
+        {
+            uint64_t total{ 0 };
+
+            for (const auto count : histogram) {
+                total += count;
+            }
+
+            uint64_t count{ 0 };
+
+            for (size_t i{ 0 }; i < histogram.size(); ++i) {
+                count += histogram[i];
+
+                if (count > 0 && static_cast<double>(count) >= quantile * static_cast<double>(total)) {
+                    return i == 0 ? 0 : uint64_t{ 1 } << i;
+                }
+            }
+
+            return 0;
+        }
+    };
+
+    // One message in kLatencySampling (per thread) has its enqueue latency measured (see Stats).
+    static constexpr uint32_t kLatencySampling{ 16 };
+
+
+    // Whether LOG statements of this severity are written (see SetMinSeverity). A single relaxed load.
+    static bool IsEnabled(Severity severity) noexcept
+    {
+        return severity >= min_severity_.load(std::memory_order_relaxed);
+    }
+
+
+    // Set the runtime minimum severity: LOG statements below it do nothing (Default: kDebug).
+    // Takes no lock; LOG statements on other threads see the change shortly after.
+    // (A logger constructed directly, without LOG, is not filtered.)
+    static void SetMinSeverity(Severity min_severity) noexcept
+    {
+        min_severity_.store(min_severity, std::memory_order_relaxed);
+    }
+
+protected:
+
+    SimpleLoggerBase() = default;
+
+
+    // The literal of the character type (Both are given; Only ASCII text is expected).
+    template <typename CharT>
+    static constexpr std::basic_string_view<CharT> Literal(std::string_view narrow, std::wstring_view wide) noexcept
+    {
+        if constexpr (std::is_same_v<CharT, char>) {
+            return narrow;
+        } else {
+            return wide;
+        }
+    }
+
+private:
+
+    // The runtime minimum severity (Read without a lock, by the LOG macro):
+    inline static std::atomic<Severity> min_severity_{ Severity::kDebug };
+};
+
+
+// An output for the log text, instead of the out stream (see SetSink and AddSink; Implementations: SimpleLogSinks.h).
+// A sink receives the finished messages, UTF-8 encoded, each with its newline (Written by one thread at a time:
+// The writer thread, a batch at a time, or a synchronous LOG statement, a message at a time). Every message is
+// formatted once, and the same bytes are handed to all the sinks; A sink encodes them further as it needs.
+// Errors are reported by throwing; The logger catches them (and goes on with the other sinks).
+
+class SimpleLogSink
+{
+public:
+
+    virtual ~SimpleLogSink() = default;
+
+    // Writes the messages. (The views are only valid during the call.)
+    virtual void Write(std::span<const std::string_view> messages) = 0;
+
+    // Called when the flush policy (see SetFlushPolicy) asks for a flush, and by Flush().
+    virtual void Flush()
+    {
+    }
+
+    // Called from a fatal signal handler (see InstallCrashHandler), possibly in the middle of Write: Writes what the
+    // sink still buffers, then the messages. Must be async-signal-safe (write(2) and the like: No allocation, no lock,
+    // no exception). Default: Nothing (The messages are lost to this sink).
+    virtual void CrashWrite(std::span<const std::string_view>) noexcept
+    {
+    }
+};
+
+
 // SimpleLogger class provides a simple logging utility for C++20 programs. 
 // It allows logging messages to an output stream with optional prefixes.
 // SimpleLogger class supports synchronized output and customization of the
 // output stream and prefix functions.
+// In the optional asynchronous mode (EnableAsync), the calling thread only composes
+// the message and enqueues it (into a shared queue, or into a per-thread ring); a writer
+// thread owned by the logger does the output.
+// CharT is the character type of the messages, prefixes and out stream: wchar_t (SimpleLogger), or char
+// (Utf8SimpleLogger: UTF-8 end to end, written to the out stream as is; Wide arguments are transcoded).
+// Each character type has its own out stream, prefix list and asynchronous mode.
 
-class SimpleLogger
+template <typename CharT>
+class BasicSimpleLogger : public SimpleLoggerBase
 {
+    static_assert(std::is_same_v<CharT, wchar_t> || std::is_same_v<CharT, char>, "CharT must be wchar_t or char (UTF-8)");
+
 public:
 
+    using String = std::basic_string<CharT>;
+    using StringView = std::basic_string_view<CharT>;
+    using Ostream = std::basic_ostream<CharT>;
+
     // Prefix function signature
-    using PrefixFunction = std::function<std::wstring()>;
+    using PrefixFunction = std::function<String()>;
 
-    enum class Severity : uint8_t { kDebug, kInfo, kWarning, kError, kCritical }; // Bounds: 0-4.
-    const std::array<std::wstring, 5> severity_map{ L"DEBUG", L"INFO", L"WARNING", L"ERROR", L"CRITICAL" };
+    // Allocation-free prefix function signature: Appends to the message (and leaves what is already there).
+    using PrefixAppender = std::function<void(String& message)>;
+
+    static constexpr std::array<StringView, 5> kSeverityNames{ Literal<CharT>("DEBUG", L"DEBUG"), Literal<CharT>("INFO", L"INFO"),
+        Literal<CharT>("WARNING", L"WARNING"), Literal<CharT>("ERROR", L"ERROR"), Literal<CharT>("CRITICAL", L"CRITICAL") };
 
 
     // Constructor
-    SimpleLogger(Severity severity = Severity::kDebug, bool newline = true) : newline_(newline)
+    // (location: The LOG statement. Recorded in asynchronous mode, for the binary output.)
+    BasicSimpleLogger(Severity severity = Severity::kDebug, bool newline = true,
+        const std::source_location& location = std::source_location::current())
+        : BasicSimpleLogger(severity, newline, location, RuntimePrefixes{})
+    {
+    }
+
+protected:
+
+    // PrefixList: RuntimePrefixes (the prefix list, see SetPrefixList), or Prefixes<...> (fixed at compile time, see SimpleLoggerT).
+    template <typename PrefixList>
+    BasicSimpleLogger(Severity severity, bool newline, const std::source_location& location, PrefixList) :
+        severity_(severity), newline_(newline)
     {
         std::shared_lock lock(mutex_);
 
-        if (out_stream_valid_) {
+        if ((sinks_.empty() ? out_stream_valid_ : severity >= sinks_min_severity_) || (async_backend_ && binary_writer_)) {
             // In the context of a logging utility, its generally not a good idea to throw exceptions because it could lead
             // to the termination of the entire process if not caught. Logging should be a non-intrusive operation and should  
             // not affect the normal flow of the program.
+            stats_shard_ = LocalStatsShard();
+            CountMessage(severity);
+
             try {
-                // May throw std::bad_alloc or any exception thrown by the constructor of T. If an exception is thrown, make_unique has no effect.
-                out_sync_stream_ = std::make_unique<std::wosyncstream>(*out_stream_.get());
-                out_sync_stream_valid_ = true;
+                if (async_backend_) {
+                    record_.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+                    record_.location = location;
+                    record_.severity = severity;
 
-                for (const auto& prefix : prefix_function_list_) {
-                    *out_sync_stream_.get() << prefix();
+                    if (deferred_formatting_) {
+                        // Deferred formatting: Only capture the arguments; The writer thread formats them.
+                        record_.arguments.reserve(kArgumentsReserve);
+                        deferred_ = true;
+                    } else {
+                        // Asynchronous mode: Compose into the message buffer, which the destructor hands over to the writer thread.
+                        AcquireStream();
+                        enqueue_ = true;
+                    }
+
+                    if (async_backend_->Mode() == QueueMode::kPerThread) {
+                        ring_ = LocalRing(*async_backend_.get());
+                    }
+                } else {
+                    // Compose into the thread's reusable message buffer; The destructor writes it as a whole.
+                    AcquireStream();
                 }
 
-                *out_sync_stream_.get() << severity_map.at(static_cast<size_t>(severity)) << L": ";
+                WritePrefixes<PrefixList>();
+
+                if (deferred_) {
+                    EncodeSeverity(severity);
+                } else {
+                    *this << kSeverityHeaders.at(static_cast<size_t>(severity));
+                }
 
             } catch (const std::exception& e) {
-                std::cerr << "caught exception: " << e.what() << std::endl;
+                ReleaseStream();
+                deferred_ = false;
+                CountDropped(1);
+                ReportException(e);
             }
         }
     }
 
 
+public:
+
     // Destructor
-    virtual ~SimpleLogger() // (Destructors are implicitly declared with noexcept)
+    virtual ~BasicSimpleLogger() // (Destructors are implicitly declared with noexcept)
     {
-        // The destruction of out_sync_stream_ involves releasing the ownership of the managed
-        // std::wosyncstream object, which indirectly accesses the associated output stream (out_stream_).
-        std::shared_lock lock(mutex_);
-
-        if (newline_ && out_sync_stream_valid_) { // (Short-circuit evaluation; Evaluates operands from left to right.)
-            *out_sync_stream_.get() << std::endl;
+        if (stream_ == nullptr && !deferred_) {
+            return;
         }
 
-        // Calling reset() on out_sync_stream_ while holding the mutex locked, releases ownership 
-        // of the std::wosyncstream object, ensuring exclusive access and preventing simultaneous 
-        // modifications to the associated output stream (out_stream_) by other threads.
-        out_sync_stream_.reset();
+        // Sampled: The time it takes to hand the message over (see GetStats).
+        const bool sample{ stats_shard_ != nullptr && ++stats_shard_->sampling % kLatencySampling == 0 };
+        const auto begin{ sample ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{} };
+
+        HandOver();
+
+        if (sample) {
+            Increment(stats_shard_->enqueue_latency[LatencyBucket(std::chrono::steady_clock::now() - begin)]);
+        }
     }
 
 
-    SimpleLogger(const SimpleLogger&) = delete; // Copy constructor.
-    SimpleLogger& operator=(const SimpleLogger&) = delete; // Copy assignment operator.
-    SimpleLogger(SimpleLogger&&) = delete; // Move constructor.
-    SimpleLogger& operator=(SimpleLogger&&) = delete; // Move assignment operator.
+    BasicSimpleLogger(const BasicSimpleLogger&) = delete; // Copy constructor.
+    BasicSimpleLogger& operator=(const BasicSimpleLogger&) = delete; // Copy assignment operator.
+    BasicSimpleLogger(BasicSimpleLogger&&) = delete; // Move constructor.
+    BasicSimpleLogger& operator=(BasicSimpleLogger&&) = delete; // Move assignment operator.
 
 
     // Operator <<
     // On use of the operator<< function with an argument of a certain type, T is replaced with that type.
     template <typename T>
-    SimpleLogger& operator<<(const T& value) noexcept
+    BasicSimpleLogger& operator<<(const T& value) noexcept
     {
-        if (out_sync_stream_valid_) {
-            *out_sync_stream_.get() << value;
+        if (stream_ != nullptr) {
+            Put(*stream_, value);
+        } else if (deferred_) {
+            try {
+                EncodeArgument(value);
+            } catch (const std::exception& e) {
+                deferred_ = false; // (Drop the message.)
+                CountDropped(1);
+                ReportException(e);
+            }
         }
 
         return *this; // Allow chaining for convenience (optional).
     }
 
 
+#if defined(__cpp_lib_format)
+    // Formats the arguments with std::format, in a single pass, straight into the message buffer (see LOG_FMT).
+    // Deferred formatting: The text is formatted now, and captured as a string argument.
+    template <typename... Args>
+    BasicSimpleLogger& Format(std::basic_format_string<CharT, std::type_identity_t<Args>...> format, Args&&... args) noexcept
+    {
+        try {
+            if (stream_ != nullptr) {
+                std::format_to(std::ostreambuf_iterator<CharT>(*stream_), format, std::forward<Args>(args)...);
+            } else if (deferred_) {
+                thread_local String text{}; // (Reused across messages.)
+
+                text.clear();
+                std::format_to(std::back_inserter(text), format, std::forward<Args>(args)...);
+                EncodeString(StringView(text));
+            }
+        } catch (const std::exception& e) {
+            deferred_ = false; // (Drop the message.)
+            CountDropped(1);
+            ReportException(e);
+        }
+
+        return *this;
+    }
+#endif
+
+
     // Setters__
 
     // Set the out stream
-    static void SetOstream(std::unique_ptr<std::wostream> out_stream) noexcept
+    static void SetOstream(std::unique_ptr<Ostream> out_stream) noexcept
     {
         std::lock_guard lock(mutex_);
+        std::lock_guard stream_lock(stream_mutex_); // (The writer thread does not take mutex_.)
 
         out_stream_ = std::move(out_stream);
         out_stream_valid_ = out_stream_.get() != nullptr && (*out_stream_.get()).good(); // (Short-circuit evaluation; Evaluates operands from left to right.)
@@ -138,45 +446,3261 @@ public:
 
 
     // Set the prefix list
+    static void SetPrefixList(const std::vector<PrefixAppender>& prefix_list) noexcept
+    {
+        std::lock_guard lock(mutex_);
+
+        try {
+            prefix_function_list_ = prefix_list; // (Copy. Take ownership)
+        } catch (const std::exception& e) {
+            ReportException(e);
+        }
+    }
+
+
+    // Set the prefix list (String returning functions: Each returned string is appended, then freed.)
+    // (A template, so that SetPrefixList({}) picks the overload above.)
+    template <typename = void>
     static void SetPrefixList(const std::vector<PrefixFunction>& prefix_list) noexcept
+    {
+        try {
+            std::vector<PrefixAppender> prefix_appender_list{};
+            prefix_appender_list.reserve(prefix_list.size());
+
+            for (const auto& prefix : prefix_list) {
+                prefix_appender_list.emplace_back([prefix](String& message) { message += prefix(); });
+            }
+
+            SetPrefixList(prefix_appender_list);
+        } catch (const std::exception& e) {
+            ReportException(e);
+        }
+    }
+
+
+    // Switch to asynchronous mode: LOG only composes the message and enqueues it, a writer thread does the output.
+    // When the queue is full, the caller yields until the writer thread makes room (see SetBackpressure).
+    static void EnableAsync(size_t queue_capacity = kDefaultQueueCapacity, QueueMode queue_mode = QueueMode::kShared) noexcept
+    {
+        std::lock_guard lock(mutex_);
+
+        if (!async_backend_) {
+            try {
+                async_backend_ = std::make_unique<AsyncBackend>(queue_capacity, queue_mode);
+
+                // Drain at exit, before the statics the writer thread uses (sinks_, format_stream_, ...) are destroyed:
+                // An atexit function runs before the destructors of the objects constructed before it was registered.
+                if (!exit_drain_registered_) {
+                    exit_drain_registered_ = std::atexit(DisableAsync) == 0;
+                }
+            } catch (const std::exception& e) {
+                ReportException(e);
+            }
+        }
+    }
+
+
+    // Switch back to synchronous mode. Blocks until all queued messages were written.
+    static void DisableAsync() noexcept
+    {
+        std::unique_ptr<AsyncBackend> async_backend{ nullptr };
+
+        {
+            // Once the exclusive lock is held, no LOG destructor is in the middle of AsyncBackend::Push(),
+            // and no thread can register a new ring.
+            std::lock_guard lock(mutex_);
+            async_backend = std::move(async_backend_);
+        }
+
+        async_backend.reset(); // Drains the queue (the rings) and joins the writer thread.
+    }
+
+
+    // Asynchronous mode: What LOG does when the queue is full (see Backpressure). E.g. Never block, but never lose
+    // ERROR and CRITICAL: { .low = Backpressure::kDrop, .high = Backpressure::kSpill, .severity = Severity::kError }.
+    // CRITICAL messages are never dropped (kDrop, kOverwrite: They are spilled), and a message is dropped only
+    // when its own backpressure allows it (kOverwrite: The oldest message is spilled instead, if not).
+    static void SetBackpressure(const BackpressurePolicy& backpressure_policy) noexcept
+    {
+        for (size_t i{ 0 }; i < backpressure_.size(); ++i) {
+            auto backpressure{ i < static_cast<size_t>(backpressure_policy.severity) ? backpressure_policy.low : backpressure_policy.high };
+
+            if (i == static_cast<size_t>(Severity::kCritical) && Droppable(backpressure)) {
+                backpressure = Backpressure::kSpill;
+            }
+
+            backpressure_[i].store(backpressure, std::memory_order_relaxed);
+        }
+    }
+
+
+    // Asynchronous mode: Defer the formatting to the writer thread.
+    // LOG then only copies the arguments (numbers, strings, format manipulators) as raw bytes, each
+    // along with a pointer to the function that formats it; Other argument types are still
+    // formatted by the calling thread. Prefix functions are always called by the calling thread.
+    static void SetDeferredFormatting(bool deferred_formatting) noexcept
+    {
+        std::lock_guard lock(mutex_);
+
+        deferred_formatting_ = deferred_formatting;
+    }
+
+
+    // Asynchronous mode: Write binary records to binary_stream, instead of text to the out stream (nullptr: Back to text).
+    // Every record holds a callsite id, the (varint, delta) timestamp and the raw argument bytes; Callsites (the
+    // LOG statement's location and argument types) are described once, before their first record.
+    // The stream should be opened in binary mode. DecodeBinary (see SimpleLogDecoder) turns it back into text.
+    // (Synchronous LOG statements still write text to the out stream.)
+    static void SetBinaryOstream(std::unique_ptr<std::ostream> binary_stream) noexcept
+    {
+        std::lock_guard lock(mutex_);
+        std::lock_guard stream_lock(stream_mutex_);
+
+        binary_writer_.reset();
+
+        if (binary_stream.get() != nullptr && (*binary_stream.get()).good()) { // (Short-circuit evaluation; Evaluates operands from left to right.)
+            try {
+                binary_writer_ = std::make_unique<BinaryWriter>(std::move(binary_stream));
+            } catch (const std::exception& e) {
+                ReportException(e);
+            }
+        }
+    }
+
+
+    // Write the text to sink (only), instead of the out stream (nullptr: Back to the out stream). See SimpleLogSink.
+    // The messages are encoded as UTF-8 once (SimpleLogger: Transcoded from wide), and no stream is involved.
+    // Asynchronous mode: The sink receives up to kSinkBatchSize messages per Write().
+    static void SetSink(std::unique_ptr<SimpleLogSink> sink) noexcept
+    {
+        std::lock_guard lock(mutex_);
+        std::lock_guard stream_lock(stream_mutex_); // (The writer thread does not take mutex_.)
+
+        try {
+            sinks_.clear();
+
+            if (sink) {
+                sinks_.push_back({ std::move(sink), Severity::kDebug });
+            }
+        } catch (const std::exception& e) {
+            ReportException(e);
+        }
+
+        UpdateSinksMinSeverity();
+    }
+
+
+    // Add a sink, for the messages of min_severity and above (Along with the sinks set or added before). E.g.
+    // Everything to a file, and WARNING and above to stderr. Messages below the min_severity of all the sinks
+    // are not composed at all.
+    static void AddSink(std::unique_ptr<SimpleLogSink> sink, Severity min_severity = Severity::kDebug) noexcept
+    {
+        if (!sink) {
+            return;
+        }
+
+        std::lock_guard lock(mutex_);
+        std::lock_guard stream_lock(stream_mutex_);
+
+        try {
+            sinks_.push_back({ std::move(sink), min_severity });
+        } catch (const std::exception& e) {
+            ReportException(e);
+        }
+
+        UpdateSinksMinSeverity();
+    }
+
+
+    // Set the flush policy (see FlushPolicy). Flushing is what makes a message reach the file (a system call);
+    // Flushing less often writes more messages per system call. (Asynchronous mode: Checked once per batch.)
+    static void SetFlushPolicy(const FlushPolicy& flush_policy) noexcept
     {
         std::lock_guard lock(mutex_);
+        std::lock_guard stream_lock(stream_mutex_); // (The writer thread does not take mutex_.)
 
-        prefix_function_list_ = prefix_list; // (Copy. Take ownership)
+        flush_policy_ = flush_policy;
+        unflushed_messages_ = 0;
     }
 
     // __Setters
 
-private:
 
-    bool newline_{ true };
+    // Flushes the out stream (Asynchronous mode: After all the messages logged so far were written. Blocks until then.)
+    static void Flush() noexcept
+    {
+        std::shared_lock lock(mutex_);
 
-    // Synchronized Output Stream:
-    // (Provides a mechanism to synchronize threads writing to the same stream.)
-    std::unique_ptr<std::wosyncstream> out_sync_stream_{ nullptr };
-    bool out_sync_stream_valid_{ false };
+        if (async_backend_) {
+            async_backend_->Flush();
+            return;
+        }
 
-    // Statics__
+        std::lock_guard stream_lock(stream_mutex_);
+        FlushStreams();
+    }
 
-    // Shared among all instances of the SimpleLogger class across the entire process.
-    // Even if there are no instances of the class SimpleLogger in existence, the static member  
-    // variables will still exist and retain their values until the program terminates.
 
-    // The prefix functions (pointers):
-    inline static std::vector<PrefixFunction> prefix_function_list_{};
+    // The logger's counters (see Stats). The per-thread counters are read while the threads go on logging.
+    static Stats GetStats() noexcept
+    {
+        Stats stats{};
 
-    // Output Stream:
-    inline static std::unique_ptr<std::wostream> out_stream_{ nullptr };
-    inline static bool out_stream_valid_{ false };
+        const auto add{ [&stats](const StatsShard& shard) {
+            for (size_t i{ 0 }; i < stats.messages.size(); ++i) {
+                stats.messages[i] += shard.messages[i].load(std::memory_order_relaxed);
+            }
 
-    // Synchronizes access to all static member variables:
-    // Allows multiple threads to concurrently read shared resources
-    // while preventing concurrent writes or read and write operations.
-    // Assumes predominantly read operations, predicting negligible
-    // impact on performance.
-    inline static std::shared_mutex mutex_{};
+            for (size_t i{ 0 }; i < stats.enqueue_latency.size(); ++i) {
+                stats.enqueue_latency[i] += shard.enqueue_latency[i].load(std::memory_order_relaxed);
+            }
+        } };
 
-    // __Statics
-};
+        {
+            std::lock_guard registry_lock(stats_registry_mutex_);
+
+            for (const auto& shard : stats_shards_) {
+                add(*shard);
+            }
+        }
+
+        add(stats_fallback_shard_);
+
+        {
+            std::lock_guard stream_lock(stream_mutex_);
+
+            stats.bytes = stats_bytes_;
+            stats.flush_latency = stats_flush_latency_;
+        }
+
+        stats.dropped_backpressure = stats_dropped_backpressure_.load(std::memory_order_relaxed);
+        stats.dropped_error = stats_dropped_error_.load(std::memory_order_relaxed);
+        stats.exceptions = stats_exceptions_.load(std::memory_order_relaxed);
+        stats.queue_high_water = stats_queue_high_water_.load(std::memory_order_relaxed);
+
+        return stats;
+    }
+
+
+#ifndef _WIN32
+    // Install a handler for the fatal signals (kCrashSignals) that writes out what was logged but not written yet, then
+    // re-raises the signal (to the handler installed before, or to the default action: E.g. A core dump).
+    // Asynchronous mode: The messages still queued go to the sinks (see SimpleLogSink::CrashWrite), or without sinks, to
+    // fd (The out stream's own buffer can not be flushed from a signal handler). Every sink also writes what it buffers.
+    // Only write(2) (and the like) is called, on state preallocated here. Left out: Deferred arguments (formatting is not
+    // async-signal-safe) and spilled messages (see Backpressure::kSpill: Guarded by a mutex). Best effort: The crash may
+    // have left the queue (or a sink) inconsistent. Once installed, the handler stays; Calling again only changes fd.
+    // The handler runs on an alternate stack (so a stack overflow can still be written out): The calling thread's and the
+    // writer thread's are set here (sigaltstack is per thread: Other threads keep theirs, if any).
+    static void InstallCrashHandler(int fd = STDERR_FILENO) noexcept
+    {
+        std::lock_guard lock(mutex_);
+
+        try {
+            if (crash_state_ == nullptr) {
+                crash_state_ = new CrashState{}; // (Never freed: A signal may come until the very end of the process.)
+
+                struct sigaction action{};
+                action.sa_handler = CrashHandler;
+                action.sa_flags = SA_ONSTACK;
+                sigemptyset(&action.sa_mask);
+
+                for (const int signal_number : kCrashSignals) {
+                    sigaddset(&action.sa_mask, signal_number); // (A fault within the handler then ends the process.)
+                }
+
+                for (size_t i{ 0 }; i < kCrashSignals.size(); ++i) {
+                    ::sigaction(kCrashSignals[i], &action, &crash_state_->previous[i]);
+                }
+            }
+
+            crash_state_->fd = fd;
+        } catch (const std::exception& e) {
+            ReportException(e);
+        }
+    }
+#endif
+
+
+    // Turns binary output (see SetBinaryOstream) back into the text the logger would have written.
+    // Throws std::runtime_error if the input is not a (complete) binary log of this platform.
+    static void DecodeBinary(std::istream& in, Ostream& out)
+    {
+        std::string header(kBinaryHeaderSize, '\0');
+
+        if (!in.read(header.data(), static_cast<std::streamsize>(header.size())) || !header.starts_with(kBinaryMagic)) {
+            throw std::runtime_error("not a binary log");
+        }
+
+        if (header[8] != static_cast<char>(kBinaryVersion) || header[9] != static_cast<char>(sizeof(wchar_t)) ||
+            header[10] != static_cast<char>(sizeof(long)) || header[11] != static_cast<char>(sizeof(long double))) {
+            throw std::runtime_error("binary log of another version or platform");
+        }
+
+        // By callsite id: The argument types, and the string arguments of the previous record.
+        std::vector<std::pair<std::vector<ArgumentType>, std::vector<std::string>>> callsites{};
+        std::string frame{};
+
+        for (;;) {
+            // Frame length (varint):
+            uint64_t length{ 0 };
+            int shift{ 0 };
+            std::istream::int_type byte{ in.get() };
+
+            if (byte == std::istream::traits_type::eof()) {
+                break; // (End of the log.)
+            }
+
+            for (; (byte & 0x80) != 0 && shift < 63; shift += 7, byte = in.get()) {
+                length |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            }
+
+            if (byte == std::istream::traits_type::eof()) {
+                throw std::runtime_error("malformed binary log: truncated frame");
+            }
+
+            length |= static_cast<uint64_t>(byte) << shift;
+
+            frame.resize(static_cast<size_t>(length));
+
+            if (length == 0 || !in.read(frame.data(), static_cast<std::streamsize>(length))) {
+                throw std::runtime_error("malformed binary log: truncated frame");
+            }
+
+            const char* data{ frame.data() + 1 };
+            const char* const end{ frame.data() + frame.size() };
+
+            if (static_cast<FrameType>(frame[0]) == FrameType::kCallsite) {
+                if (ReadVarint(data, end) != callsites.size()) {
+                    throw std::runtime_error("malformed binary log: callsite out of order");
+                }
+
+                ReadVarint(data, end); // (Line.)
+                const uint64_t file_name_length{ ReadVarint(data, end) };
+
+                if (static_cast<uint64_t>(end - data) < file_name_length) {
+                    throw std::runtime_error("malformed binary log: truncated callsite");
+                }
+
+                data += file_name_length;
+                const uint64_t count{ ReadVarint(data, end) };
+
+                if (static_cast<uint64_t>(end - data) != count) {
+                    throw std::runtime_error("malformed binary log: truncated callsite");
+                }
+
+                callsites.emplace_back(std::vector<ArgumentType>(reinterpret_cast<const ArgumentType*>(data), reinterpret_cast<const ArgumentType*>(end)),
+                    std::vector<std::string>(static_cast<size_t>(count)));
+            } else if (static_cast<FrameType>(frame[0]) == FrameType::kRecord) {
+                const uint64_t callsite{ ReadVarint(data, end) };
+
+                if (callsite >= callsites.size()) {
+                    throw std::runtime_error("malformed binary log: unknown callsite");
+                }
+
+                ReadSignedVarint(data, end); // (Timestamp delta: Not part of the text.)
+
+                auto& [types, strings] { callsites[callsite] };
+
+                for (size_t i{ 0 }; i < types.size(); ++i) {
+                    DecodeBinaryArgument(types[i], data, end, strings[i], out);
+                }
+
+                ResetFormat(out);
+            } else {
+                throw std::runtime_error("malformed binary log: unknown frame type");
+            }
+        }
+    }
+
+
+    // Date & Time prefix: "dd-mm-yyyy hh:mm:ss.mmm " (local time).
+    // The date and time are formatted once per second (per thread, so no lock is taken); Every
+    // call only patches in the milliseconds. (No localtime, no stream and no allocation per message.)
+    static void TimestampPrefix(String& message)
+    {
+        message.append(LocalTimestamp());
+    }
+
+private:
+
+    // "dd-mm-yyyy hh:mm:ss.mmm "
+    static constexpr size_t kTimestampLength{ 24 };
+
+    // The calling thread's timestamp, updated to now.
+    static StringView LocalTimestamp()
+    {
+        thread_local std::array<CharT, kTimestampLength> text{};
+        thread_local int64_t cached_second{ std::numeric_limits<int64_t>::min() };
+
+        const auto since_epoch{ std::chrono::system_clock::now().time_since_epoch() };
+        const auto seconds{ std::chrono::floor<std::chrono::seconds>(since_epoch) };
+        const auto milliseconds{ std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch - seconds).count() };
+
+        if (seconds.count() != cached_second) {
+            const auto in_time_t{ static_cast<std::time_t>(seconds.count()) };
+            std::tm time_info{};
+
+#ifdef _WIN32
+            localtime_s(&time_info, &in_time_t);
+#else
+            localtime_r(&in_time_t, &time_info);
+#endif
+
+            PutDigits(text, 0, 2, time_info.tm_mday);
+            text[2] = static_cast<CharT>('-');
+            PutDigits(text, 3, 2, time_info.tm_mon + 1);
+            text[5] = static_cast<CharT>('-');
+            PutDigits(text, 6, 4, time_info.tm_year + 1900);
+            text[10] = static_cast<CharT>(' ');
+            PutDigits(text, 11, 2, time_info.tm_hour);
+            text[13] = static_cast<CharT>(':');
+            PutDigits(text, 14, 2, time_info.tm_min);
+            text[16] = static_cast<CharT>(':');
+            PutDigits(text, 17, 2, time_info.tm_sec);
+            text[19] = static_cast<CharT>('.');
+            text[23] = static_cast<CharT>(' ');
+
+            cached_second = seconds.count();
+        }
+
+        PutDigits(text, 20, 3, static_cast<int>(milliseconds));
+
+        return { text.data(), text.size() };
+    }
+
+
+    // Writes value as count decimal digits (zero padded) at position.
+    static void PutDigits(std::array<CharT, kTimestampLength>& text, size_t position, size_t count, int value) noexcept
+    {
+        for (size_t i{ count }; i > 0; --i) {
+            text[position + i - 1] = static_cast<CharT>('0' + value % 10);
+            value /= 10;
+        }
+    }
+
+
+    // A finished message, as handed from the LOG temporary to the writer thread.
+    struct Record
+    {
+        String text{}; // The composed message.
+        std::string arguments{}; // Deferred formatting: The captured arguments (raw bytes), formatted by the writer thread.
+        int64_t timestamp{ 0 }; // (Nanoseconds since the epoch.)
+        std::source_location location{};
+        Severity severity{ Severity::kDebug }; // (For the flush policy.)
+    };
+
+    // Keeps the producer and consumer positions (and the queue cells) on separate cache lines.
+    static constexpr size_t kCacheLineSize{ 64 };
+
+    // kPerThread: Maximal number of messages taken from one ring before moving on to the next one.
+    static constexpr size_t kRingBatchSize{ 64 };
+
+    // Maximal number of messages the writer thread writes as one batch (under stream_mutex_, through one osyncstream).
+    static constexpr size_t kWriteBatchSize{ 1024 };
+
+
+    // Lets producers wake the writer thread, without a system call while it is busy.
+    class WakeSignal
+    {
+    public:
+
+        // Producer side, after publishing a record.
+        void Notify() noexcept
+        {
+            // Pairs with the fence in Sleep(): Either the writer thread sees the record, or we see it idle.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (idle_.load(std::memory_order_relaxed)) {
+                Wake();
+            }
+        }
+
+
+        void Wake() noexcept
+        {
+            if (idle_.exchange(false)) {
+                std::lock_guard lock(mutex_); // (The writer thread is either before its check of idle_, or waiting.)
+                woken_.notify_one();
+            }
+        }
+
+
+        // Writer thread side. Announces going to sleep, then re-checks (pending), so that a concurrent Notify() can not be missed.
+        // Sleeps until woken, or until the deadline (if any).
+        template <typename PendingFunction>
+        void Sleep(PendingFunction pending, std::optional<std::chrono::steady_clock::time_point> deadline) noexcept
+        {
+            idle_.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (!pending()) {
+                std::unique_lock lock(mutex_);
+                const auto woken{ [this] { return !idle_.load(); } };
+
+                if (deadline) {
+                    woken_.wait_until(lock, *deadline, woken);
+                } else {
+                    woken_.wait(lock, woken);
+                }
+            }
+
+            idle_.store(false);
+        }
+
+    private:
+
+        std::atomic<bool> idle_{ false };
+        std::mutex mutex_{};
+        std::condition_variable woken_{};
+    };
+
+
+    // Backpressure::kSpill: The growable overflow of the queue (the rings). Guarded by a mutex: Only taken when full.
+    class Overflow
+    {
+    public:
+
+        // Producer side. (Drops the record if out of memory.)
+        void Spill(Record& record) noexcept
+        {
+            try {
+                std::lock_guard lock(mutex_);
+
+                records_.push_back(std::move(record));
+                size_.store(size_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            } catch (const std::exception& e) {
+                CountDropped(1);
+                ReportException(e);
+            }
+        }
+
+
+        bool Empty() const noexcept
+        {
+            return size_.load(std::memory_order_relaxed) == 0;
+        }
+
+
+        // Writer thread side: Takes all the spilled records. (Swaps vectors: The capacity of both is kept.)
+        // They still count (see Empty) until Written().
+        void Take(std::vector<Record>& records) noexcept
+        {
+            records.clear();
+
+            std::lock_guard lock(mutex_);
+
+            records_.swap(records);
+        }
+
+
+        // Writer thread side: The records taken were written.
+        void Written() noexcept
+        {
+            std::lock_guard lock(mutex_);
+
+            size_.store(records_.size(), std::memory_order_relaxed);
+        }
+
+    private:
+
+        std::mutex mutex_{};
+        std::vector<Record> records_{};
+        std::atomic<size_t> size_{ 0 }; // Spilled, and not written yet.
+    };
+
+
+    static Backpressure BackpressureOf(Severity severity) noexcept
+    {
+        return backpressure_[static_cast<size_t>(severity)].load(std::memory_order_relaxed);
+    }
+
+
+    static constexpr bool Droppable(Backpressure backpressure) noexcept
+    {
+        return backpressure == Backpressure::kDrop || backpressure == Backpressure::kOverwrite;
+    }
+
+
+    // A full queue refused the record (or evicted it, see Backpressure::kOverwrite): Spills it, unless its backpressure drops it.
+    static void Refuse(Record& record, Overflow& overflow) noexcept
+    {
+        if (Droppable(BackpressureOf(record.severity))) {
+            stats_dropped_backpressure_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            overflow.Spill(record);
+        }
+    }
+
+
+    // A reader-writer lock for read-mostly data, whose readers never write a shared cache line.
+    // Every reading thread owns a slot (its own cache line), and announces itself there; A writer raises
+    // writer_, then waits until no slot is active. (Dekker style: A reader stores to its slot, then loads
+    // writer_; A writer stores writer_, then loads the slots; Both seq_cst, so at least one sees the other.)
+    // Readers may nest. A thread that reads during its exit (after its slot was released) uses fallback_.
+    // Meets the SharedMutex requirements used here: lock, unlock, lock_shared and unlock_shared.
+    // (Only one instance per BasicSimpleLogger<CharT>: The slot is found through a thread_local.)
+    class ConfigMutex
+    {
+    public:
+
+        void lock_shared()
+        {
+            ReaderSlot* const slot{ LocalSlot() };
+
+            if (slot == nullptr) {
+                fallback_.lock_shared();
+                return;
+            }
+
+            if (slot->depth++ > 0) {
+                return;
+            }
+
+            for (;;) {
+                slot->active.store(true);
+
+                if (!writer_.load()) {
+                    return;
+                }
+
+                // A writer is (or is about to be) in: Back off until it is done.
+                slot->active.store(false);
+                writer_.wait(true);
+            }
+        }
+
+
+        void unlock_shared()
+        {
+            ReaderSlot* const slot{ LocalSlot() };
+
+            if (slot == nullptr) {
+                fallback_.unlock_shared();
+                return;
+            }
+
+            if (--slot->depth == 0) {
+                slot->active.store(false, std::memory_order_release);
+            }
+        }
+
+
+        void lock()
+        {
+            writer_mutex_.lock();
+            fallback_.lock();
+            writer_.store(true);
+
+            std::lock_guard registry_lock(registry_mutex_);
+
+            for (const auto& slot : slots_) {
+                while (slot->active.load()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+
+        void unlock()
+        {
+            writer_.store(false);
+            writer_.notify_all();
+            fallback_.unlock();
+            writer_mutex_.unlock();
+        }
+
+    private:
+
+        struct alignas(kCacheLineSize) ReaderSlot
+        {
+            std::atomic<bool> active{ false };
+            size_t depth{ 0 }; // (Owner thread only.)
+            bool owned{ false }; // (Under registry_mutex_.)
+        };
+
+
+        // Returns the calling thread's slot (claims one on first use); nullptr during thread exit.
+        ReaderSlot* LocalSlot()
+        {
+            thread_local bool destroyed{ false }; // (Trivially destructible: Readable during thread exit.)
+
+            struct SlotHandle
+            {
+                ConfigMutex* mutex{ nullptr };
+                ReaderSlot* slot{ nullptr };
+
+                ~SlotHandle()
+                {
+                    destroyed = true;
+
+                    if (slot != nullptr) {
+                        std::lock_guard registry_lock(mutex->registry_mutex_);
+                        slot->owned = false; // (Reused by the next thread.)
+                    }
+                }
+            };
+
+            if (destroyed) {
+                return nullptr;
+            }
+
+            thread_local SlotHandle handle{};
+
+            if (handle.slot == nullptr) {
+                handle.mutex = this;
+                handle.slot = ClaimSlot();
+            }
+
+            return handle.slot;
+        }
+
+
+        ReaderSlot* ClaimSlot()
+        {
+            std::lock_guard registry_lock(registry_mutex_);
+
+            for (const auto& slot : slots_) {
+                if (!slot->owned) {
+                    slot->owned = true;
+                    return slot.get();
+                }
+            }
+
+            slots_.push_back(std::make_unique<ReaderSlot>());
+            slots_.back()->owned = true;
+
+            return slots_.back().get();
+        }
+
+
+        std::atomic<bool> writer_{ false };
+        std::mutex writer_mutex_{}; // (Writers one at a time.)
+        std::shared_mutex fallback_{};
+        std::mutex registry_mutex_{}; // (Guards slots_. Taken once per thread, and by writers.)
+        std::vector<std::unique_ptr<ReaderSlot>> slots_{}; // (Never shrinks: A slot's address is stable.)
+    };
+
+
+    // Bounded lock-free multi-producer queue, with a single consumer (and producers evicting the oldest record).
+    // (Dmitry Vyukov's bounded queue: Every cell carries a sequence number that tells whether
+    // it is free for the producer at a given position, or ready for the consumer. Producers
+    // claim positions with a CAS on enqueue_position_, consumers with a CAS on dequeue_position_;
+    // No lock is ever taken.)
+    class RecordQueue
+    {
+    public:
+
+        explicit RecordQueue(size_t capacity) :
+            mask_(std::bit_ceil(capacity < 2 ? size_t{ 2 } : capacity) - 1),
+            cells_(std::make_unique<Cell[]>(mask_ + 1))
+        {
+            for (size_t i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+
+        // Returns false (and leaves record untouched) if the queue is full.
+        bool TryPush(Record& record) noexcept
+        {
+            size_t position{ enqueue_position_.load(std::memory_order_relaxed) };
+
+            for (;;) {
+                Cell& cell{ cells_[position & mask_] };
+                const size_t sequence{ cell.sequence.load(std::memory_order_acquire) };
+                const auto difference{ static_cast<std::ptrdiff_t>(sequence - position) };
+
+                if (difference == 0) {
+                    // The cell is free: Try to claim the position.
+                    if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.record = std::move(record);
+                        cell.sequence.store(position + 1, std::memory_order_release); // Publish to the consumer.
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false; // The cell still holds a record from the previous lap: Full.
+                } else {
+                    position = enqueue_position_.load(std::memory_order_relaxed); // Another producer claimed it.
+                }
+            }
+        }
+
+
+        // Returns false if the queue is empty. (The consumer, or a producer evicting the oldest record.)
+        bool TryPop(Record& record) noexcept
+        {
+            size_t position{ dequeue_position_.load(std::memory_order_relaxed) };
+
+            for (;;) {
+                Cell& cell{ cells_[position & mask_] };
+                const size_t sequence{ cell.sequence.load(std::memory_order_acquire) };
+                const auto difference{ static_cast<std::ptrdiff_t>(sequence - (position + 1)) };
+
+                if (difference == 0) {
+                    // The cell is ready: Try to claim the position.
+                    if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        record = std::move(cell.record);
+                        cell.sequence.store(position + mask_ + 1, std::memory_order_release); // Free the cell for the next lap.
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false; // Empty.
+                } else {
+                    position = dequeue_position_.load(std::memory_order_relaxed); // Another one took it.
+                }
+            }
+        }
+
+
+        bool Empty() const noexcept
+        {
+            const size_t position{ dequeue_position_.load(std::memory_order_relaxed) };
+
+            return cells_[position & mask_].sequence.load(std::memory_order_acquire) != position + 1;
+        }
+
+
+        // Crash handler: Visits the records queued, without taking them.
+        template <typename VisitFunction>
+        void ForEachQueued(VisitFunction visit) const noexcept
+        {
+            for (size_t position{ dequeue_position_.load(std::memory_order_relaxed) };
+                cells_[position & mask_].sequence.load(std::memory_order_acquire) == position + 1; ++position) {
+                visit(cells_[position & mask_].record);
+            }
+        }
+
+
+        // Records queued (or being pushed).
+        size_t Depth() const noexcept
+        {
+            const size_t dequeue_position{ dequeue_position_.load(std::memory_order_relaxed) }; // (First: Never ahead of enqueue_position_.)
+
+            return enqueue_position_.load(std::memory_order_relaxed) - dequeue_position;
+        }
+
+    private:
+
+        struct alignas(kCacheLineSize) Cell
+        {
+            std::atomic<size_t> sequence{ 0 };
+            Record record{};
+        };
+
+        const size_t mask_;
+        const std::unique_ptr<Cell[]> cells_;
+
+        alignas(kCacheLineSize) std::atomic<size_t> enqueue_position_{ 0 };
+        alignas(kCacheLineSize) std::atomic<size_t> dequeue_position_{ 0 };
+    };
+
+
+    // Bounded single-producer single-consumer ring, owned (shared) by one logging thread and the writer thread.
+    // The producer writes only tail_ and active_, the consumer writes only head_; Each index is
+    // read by the other side only when its cached copy says the ring is full (empty).
+    class ThreadRing
+    {
+    public:
+
+        ThreadRing(size_t capacity, WakeSignal& wake_signal, Overflow& overflow) :
+            mask_(std::bit_ceil(capacity < 2 ? size_t{ 2 } : capacity) - 1),
+            records_(std::make_unique<Record[]>(mask_ + 1)),
+            wake_signal_(wake_signal),
+            overflow_(overflow)
+        {
+        }
+
+
+        // Producer (owning thread) only. Returns false (and leaves record untouched) if the
+        // ring was closed, because the writer thread is shutting down.
+        bool Push(Record& record) noexcept
+        {
+            // While active_ is set, the writer thread (and wake_signal_, overflow_) can not go away.
+            // (Pairs with Close(): Either we see the ring closed, or the writer thread waits for us.)
+            active_.store(true);
+
+            if (closed_.load()) {
+                active_.store(false, std::memory_order_release);
+                return false;
+            }
+
+            const Backpressure backpressure{ BackpressureOf(record.severity) };
+
+            bool refuse{ false };
+
+            // Full, or spilled messages are waiting in the overflow (they are written after the ring: Keeps the order of the messages).
+            while (!refuse && (tail_ - cached_head_ > mask_ || !overflow_.Empty())) {
+                cached_head_ = head_.load(std::memory_order_acquire);
+
+                if (tail_ - cached_head_ > mask_ || !overflow_.Empty()) {
+                    wake_signal_.Wake(); // Full: Let the writer thread make room.
+                    refuse = backpressure != Backpressure::kBlock;
+
+                    if (!refuse) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            if (refuse) {
+                Refuse(record, overflow_);
+                wake_signal_.Notify();
+
+                active_.store(false, std::memory_order_release);
+                return true;
+            }
+
+            records_[tail_ & mask_] = std::move(record);
+            tail_published_.store(++tail_, std::memory_order_release);
+
+            wake_signal_.Notify();
+
+            active_.store(false, std::memory_order_release);
+            return true;
+        }
+
+
+        // Consumer only. Returns false if the ring is empty.
+        bool TryPop(Record& record) noexcept
+        {
+            if (head_local_ == cached_tail_) {
+                cached_tail_ = tail_published_.load(std::memory_order_acquire);
+
+                if (head_local_ == cached_tail_) {
+                    return false;
+                }
+            }
+
+            record = std::move(records_[head_local_ & mask_]);
+            head_.store(++head_local_, std::memory_order_release);
+
+            return true;
+        }
+
+
+        // Consumer only.
+        bool Empty() noexcept
+        {
+            return head_local_ == tail_published_.load(std::memory_order_acquire);
+        }
+
+
+        // Consumer only.
+        size_t Depth() noexcept
+        {
+            return tail_published_.load(std::memory_order_acquire) - head_local_;
+        }
+
+
+        // Crash handler: Visits the records queued, without taking them.
+        template <typename VisitFunction>
+        void ForEachQueued(VisitFunction visit) const noexcept
+        {
+            const size_t tail{ tail_published_.load(std::memory_order_acquire) };
+
+            for (size_t position{ head_.load(std::memory_order_acquire) }; position != tail; ++position) {
+                visit(records_[position & mask_]);
+            }
+        }
+
+
+        // Consumer only: Refuse further pushes (they fall back to a synchronous write).
+        void Close() noexcept
+        {
+            closed_.store(true);
+        }
+
+        bool Closed() const noexcept
+        {
+            return closed_.load(std::memory_order_acquire);
+        }
+
+        // True while the producer is in the middle of Push().
+        bool Active() const noexcept
+        {
+            return active_.load();
+        }
+
+
+        // The owning thread exited: The ring can be dropped, once drained.
+        void Orphan() noexcept
+        {
+            orphaned_.store(true, std::memory_order_release);
+        }
+
+        bool Orphaned() const noexcept
+        {
+            return orphaned_.load(std::memory_order_acquire);
+        }
+
+    private:
+
+        const size_t mask_;
+        const std::unique_ptr<Record[]> records_;
+        WakeSignal& wake_signal_;
+        Overflow& overflow_;
+
+        // Producer side:
+        alignas(kCacheLineSize) size_t tail_{ 0 };
+        size_t cached_head_{ 0 };
+        std::atomic<size_t> tail_published_{ 0 };
+        std::atomic<bool> active_{ false };
+
+        // Consumer side:
+        alignas(kCacheLineSize) std::atomic<size_t> head_{ 0 };
+        size_t head_local_{ 0 };
+        size_t cached_tail_{ 0 };
+        std::atomic<bool> closed_{ false };
+
+        alignas(kCacheLineSize) std::atomic<bool> orphaned_{ false };
+    };
+
+
+    // Owns the queue (the rings) and the writer thread that drains it into out_stream_.
+    class AsyncBackend
+    {
+    public:
+
+        AsyncBackend(size_t queue_capacity, QueueMode queue_mode) :
+            queue_mode_(queue_mode),
+            queue_capacity_(queue_capacity),
+            queue_(queue_mode == QueueMode::kShared ? std::make_unique<RecordQueue>(queue_capacity) : nullptr),
+            writer_thread_([this](std::stop_token stop_token) { Run(stop_token); })
+        {
+        }
+
+
+        // Drains whatever is still queued, then joins the writer thread.
+        ~AsyncBackend()
+        {
+            writer_thread_.request_stop();
+            wake_signal_.Wake();
+            writer_thread_.join();
+        }
+
+
+        AsyncBackend(const AsyncBackend&) = delete;
+        AsyncBackend& operator=(const AsyncBackend&) = delete;
+
+
+        QueueMode Mode() const noexcept
+        {
+            return queue_mode_;
+        }
+
+
+        // kShared: Called by the producers (any thread). When the queue is full, see Backpressure.
+        void Push(Record&& record) noexcept
+        {
+            const Backpressure backpressure{ BackpressureOf(record.severity) };
+
+            // Full, or spilled messages are waiting in the overflow (they are written after the queue: Keeps the order of the messages).
+            while (!overflow_.Empty() || !queue_->TryPush(record)) {
+                wake_signal_.Wake();
+
+                if (backpressure == Backpressure::kOverwrite && overflow_.Empty()) {
+                    Record oldest{};
+
+                    if (queue_->TryPop(oldest)) {
+                        Refuse(oldest, overflow_);
+                    }
+                } else if (backpressure != Backpressure::kBlock) {
+                    Refuse(record, overflow_); // (kOverwrite: Dropped, evicting would not make room ahead of the overflow.)
+                    break;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+
+            wake_signal_.Notify();
+        }
+
+
+        // kPerThread: Creates a ring for the calling thread (once per thread).
+        // If the writer thread is already shutting down, the ring is returned closed.
+        std::shared_ptr<ThreadRing> RegisterRing()
+        {
+            auto ring{ std::make_shared<ThreadRing>(queue_capacity_, wake_signal_, overflow_) };
+
+            std::lock_guard lock(registry_mutex_);
+
+            if (accepting_rings_) {
+                new_rings_.push_back(ring);
+                rings_registered_.store(true, std::memory_order_release);
+            } else {
+                ring->Close();
+            }
+
+            return ring;
+        }
+
+
+        // Crash handler: Visits the records queued (in the rings), without taking them. (No lock is taken: Best effort.)
+        template <typename VisitFunction>
+        void ForEachQueued(VisitFunction visit) const noexcept
+        {
+            if (queue_) {
+                queue_->ForEachQueued(visit);
+                return;
+            }
+
+            for (const auto& ring : rings_) {
+                ring->ForEachQueued(visit);
+            }
+
+            for (const auto& ring : new_rings_) {
+                ring->ForEachQueued(visit);
+            }
+        }
+
+
+        // Blocks until the writer thread has written everything queued so far, and flushed the out stream.
+        void Flush() noexcept
+        {
+            const uint64_t request{ flush_requests_.fetch_add(1) + 1 };
+            wake_signal_.Wake();
+
+            for (uint64_t flushed{ flushed_.load() }; flushed < request; flushed = flushed_.load()) {
+                flushed_.wait(flushed);
+            }
+        }
+
+    private:
+
+        void Run(std::stop_token stop_token) noexcept
+        {
+#ifndef _WIN32
+            const CrashStack crash_stack{}; // (Sinks run on this thread: See InstallCrashHandler.)
+#endif
+
+            for (;;) {
+                // (Read before the pass: Whatever was queued before the request is written by it.)
+                const uint64_t flush_request{ flush_requests_.load() };
+                const bool drained{ Drain() };
+
+                // Served after the pass, also when more records were queued meanwhile (producers that keep logging do not delay it).
+                if (flush_request != flushed_.load(std::memory_order_relaxed)) {
+                    {
+                        std::lock_guard lock(stream_mutex_);
+                        FlushStreams();
+                    }
+
+                    flushed_.store(flush_request);
+                    flushed_.notify_all();
+                }
+
+                if (drained) {
+                    continue;
+                }
+
+                if (stop_token.stop_requested()) {
+                    Shutdown();
+                    return;
+                }
+
+                wake_signal_.Sleep([this, &stop_token] {
+                    return Pending() || flush_requests_.load() != flushed_.load(std::memory_order_relaxed) || stop_token.stop_requested(); },
+                    FlushOnInterval());
+            }
+        }
+
+
+        // True if there is anything to drain (or new rings to adopt).
+        bool Pending() noexcept
+        {
+            if (!overflow_.Empty()) {
+                return true;
+            }
+
+            if (queue_) {
+                return !queue_->Empty();
+            }
+
+            return rings_registered_.load(std::memory_order_acquire) ||
+                std::any_of(rings_.begin(), rings_.end(), [](const auto& ring) { return !ring->Empty(); });
+        }
+
+
+        // One pass: Writes the records queued when it starts (then the overflow). Returns false if nothing was queued.
+        bool Drain() noexcept
+        {
+            // The spilled records are taken before the queue is drained, and written after it: Until then, the overflow is not
+            // empty, so no thread queues a message behind one it spilled. (Everything queued meanwhile is older.)
+            const bool spilled{ !overflow_.Empty() };
+
+            if (spilled) {
+                overflow_.Take(spilled_);
+            }
+
+            const bool drained{ DrainQueue() };
+
+            return (spilled && DrainOverflow()) || drained;
+        }
+
+
+        // Backpressure::kSpill: Writes the spilled records taken by Drain().
+        bool DrainOverflow() noexcept
+        {
+            size_t index{ 0 };
+
+            const bool drained{ WriteBatches([this, &index](Record& record) {
+                if (index == spilled_.size()) {
+                    return false;
+                }
+
+                record = std::move(spilled_[index++]);
+                return true;
+            }) };
+
+            spilled_.clear();
+            overflow_.Written();
+
+            return drained;
+        }
+
+
+        // Takes (at most) the records queued when it starts: Records queued meanwhile are left for the next pass.
+        bool DrainQueue() noexcept
+        {
+            if (queue_) {
+                size_t budget{ queue_->Depth() };
+                UpdateHighWater(budget);
+
+                return WriteBatches([this, &budget](Record& record) {
+                    // (A producer may have claimed the next cell, and not have published it yet: Waits for it.)
+                    for (; budget != 0; std::this_thread::yield()) {
+                        if (queue_->TryPop(record)) {
+                            --budget;
+                            return true;
+                        }
+
+                        if (queue_->Depth() == 0) {
+                            return false; // (Backpressure::kOverwrite took the rest.)
+                        }
+                    }
+
+                    return false;
+                });
+            }
+
+            AdoptRings();
+
+            if (rings_.empty()) {
+                return false;
+            }
+
+            ring_budgets_.resize(rings_.size());
+
+            for (size_t i{ 0 }; i < rings_.size(); ++i) {
+                ring_budgets_[i] = rings_[i]->Depth();
+                UpdateHighWater(ring_budgets_[i]);
+            }
+
+            // Round-robin: Take up to kRingBatchSize records from each ring in turn, until a full
+            // round over all rings comes back empty.
+            size_t index{ 0 };
+            size_t taken{ 0 };
+            size_t empty_in_a_row{ 0 };
+
+            const bool drained{ WriteBatches([&](Record& record) {
+                while (empty_in_a_row < rings_.size()) {
+                    if (taken < kRingBatchSize && ring_budgets_[index] != 0 && rings_[index]->TryPop(record)) {
+                        ++taken;
+                        --ring_budgets_[index];
+                        return true;
+                    }
+
+                    empty_in_a_row = taken == 0 ? empty_in_a_row + 1 : 0;
+                    taken = 0;
+                    index = (index + 1) % rings_.size();
+                }
+
+                return false;
+            }) };
+
+            // Unregister the rings of exited threads. (Orphaned is checked first: The last push happens before it.)
+            std::erase_if(rings_, [](const auto& ring) { return ring->Orphaned() && ring->Empty(); });
+
+            return drained;
+        }
+
+
+        // (Writer thread only.)
+        static void UpdateHighWater(size_t depth) noexcept
+        {
+            if (depth > stats_queue_high_water_.load(std::memory_order_relaxed)) {
+                stats_queue_high_water_.store(depth, std::memory_order_relaxed);
+            }
+        }
+
+
+        // Writes (pop) records in batches of up to kWriteBatchSize, until pop returns false. Returns false if there was none.
+        template <typename PopFunction>
+        bool WriteBatches(PopFunction pop) noexcept
+        {
+            bool written{ false };
+            size_t count{ kWriteBatchSize };
+
+            while (count == kWriteBatchSize) {
+                count = 0;
+
+                if (!WriteBatch([&pop, &count](Record& record) { return count != kWriteBatchSize && pop(record) && ++count != 0; })) {
+                    break;
+                }
+
+                written = true;
+            }
+
+            return written;
+        }
+
+
+        // Writes (pop) records to out_stream_ until pop returns false. Returns false if there was none.
+        template <typename PopFunction>
+        bool WriteBatch(PopFunction pop) noexcept
+        {
+            if (!pop(record_)) {
+                return false;
+            }
+
+            std::lock_guard lock(stream_mutex_);
+
+            try {
+                bool flush{ false }; // (Flush at most once per batch, instead of once per message.)
+
+                if (binary_writer_) {
+                    do {
+                        binary_writer_->Write(record_);
+                        flush = FlushDue(record_.severity) || flush;
+                    } while (pop(record_));
+
+                    if (flush) {
+                        TimedFlush([] { binary_writer_->Flush(); });
+                    }
+                } else if (!sinks_.empty()) {
+                    do {
+                        SinkAdd(record_);
+                        flush = FlushDue(record_.severity) || flush;
+                    } while (pop(record_));
+
+                    SinkWrite();
+
+                    if (flush) {
+                        TimedFlush(SinkFlush);
+                    }
+                } else if (out_stream_valid_) {
+                    // Emitting through a synchronized stream serializes the batch with synchronous writers (if any).
+                    std::basic_osyncstream<CharT> out_sync_stream(*out_stream_.get());
+
+                    do {
+                        WriteRecordCounted(out_sync_stream, record_);
+                        flush = FlushDue(record_.severity) || flush;
+                    } while (pop(record_));
+
+                    if (flush) {
+                        TimedFlush([&out_sync_stream] {
+                            out_sync_stream << std::flush;
+                            out_sync_stream.emit(); // (Emits the batch, and flushes the out stream.)
+                        });
+                    }
+                } else {
+                    size_t count{ 1 };
+
+                    while (pop(record_)) {
+                        ++count;
+                    }
+
+                    CountDropped(count);
+                }
+            } catch (const std::exception& e) {
+                CountDropped(1 + std::exchange(sink_batch_.count, 0)); // (Drop a partial sink batch.)
+                ReportException(e);
+            }
+
+            return true;
+        }
+
+
+        // kPerThread: Takes over the rings registered since the last call.
+        void AdoptRings()
+        {
+            if (!rings_registered_.load(std::memory_order_acquire)) {
+                return;
+            }
+
+            std::lock_guard lock(registry_mutex_);
+
+            rings_.insert(rings_.end(), new_rings_.begin(), new_rings_.end());
+            new_rings_.clear();
+            rings_registered_.store(false, std::memory_order_relaxed);
+        }
+
+
+        // Closes all rings, waits for producers in the middle of a push (draining, as they may wait
+        // for room), then drains what is left.
+        void Shutdown() noexcept
+        {
+            if (!queue_) {
+                {
+                    std::lock_guard lock(registry_mutex_);
+                    accepting_rings_ = false;
+                }
+
+                AdoptRings();
+
+                for (const auto& ring : rings_) {
+                    ring->Close();
+                }
+
+                while (std::any_of(rings_.begin(), rings_.end(), [](const auto& ring) { return ring->Active(); })) {
+                    Drain();
+                    std::this_thread::yield();
+                }
+            }
+
+            while (Drain()) {}
+        }
+
+
+        const QueueMode queue_mode_;
+        const size_t queue_capacity_;
+
+        // kShared:
+        const std::unique_ptr<RecordQueue> queue_;
+
+        // kPerThread:
+        std::vector<std::shared_ptr<ThreadRing>> rings_{}; // (Writer thread only.)
+        std::vector<size_t> ring_budgets_{}; // Records left to take from each ring, in the current pass. (Writer thread only.)
+        std::vector<std::shared_ptr<ThreadRing>> new_rings_{}; // Registered, not yet adopted by the writer thread.
+        std::atomic<bool> rings_registered_{ false };
+        bool accepting_rings_{ true };
+        std::mutex registry_mutex_{}; // (Taken once per thread, on registration.)
+
+        Record record_{}; // (Writer thread only.)
+        WakeSignal wake_signal_{};
+
+        // Backpressure::kSpill:
+        Overflow overflow_{};
+        std::vector<Record> spilled_{}; // (Writer thread only. Taken from overflow_.)
+
+        // Flush(): Requests made, and the last request served by the writer thread.
+        std::atomic<uint64_t> flush_requests_{ 0 };
+        std::atomic<uint64_t> flushed_{ 0 };
+
+        std::jthread writer_thread_; // (Last: Starts running once everything above is initialized.)
+    };
+
+
+    // The severity headers, as written (see kSeverityNames). Compile-time data: Nothing is constructed per message.
+    static constexpr std::array<StringView, 5> kSeverityHeaders{ Literal<CharT>("DEBUG: ", L"DEBUG: "), Literal<CharT>("INFO: ", L"INFO: "),
+        Literal<CharT>("WARNING: ", L"WARNING: "), Literal<CharT>("ERROR: ", L"ERROR: "), Literal<CharT>("CRITICAL: ", L"CRITICAL: ") };
+
+
+    // Reserved capacity (in characters) of the message buffer.
+    static constexpr size_t kMessageReserve{ 512 };
+
+    // A stream buffer that composes a message into a string, whose capacity is kept between messages.
+    class MessageBuffer : public std::basic_streambuf<CharT>
+    {
+    public:
+        MessageBuffer()
+        {
+            text_.resize(kMessageReserve);
+            Clear();
+        }
+
+        StringView View() const noexcept
+        {
+            return { this->pbase(), static_cast<size_t>(this->pptr() - this->pbase()) };
+        }
+
+        void Clear() noexcept
+        {
+            text_.resize(text_.capacity()); // (No allocation.)
+            this->setp(text_.data(), text_.data() + text_.size());
+        }
+
+        // The message as a string, to be appended to (by the prefixes). Resume() before writing to the stream again.
+        String& Text() noexcept
+        {
+            text_.resize(static_cast<size_t>(this->pptr() - this->pbase()));
+            return text_;
+        }
+
+        void Resume() noexcept
+        {
+            const auto size{ text_.size() };
+            text_.resize(text_.capacity()); // (No allocation.)
+            this->setp(text_.data(), text_.data() + text_.size());
+            this->pbump(static_cast<int>(size));
+        }
+
+    protected:
+        using typename std::basic_streambuf<CharT>::int_type;
+        using typename std::basic_streambuf<CharT>::traits_type;
+
+        int_type overflow(int_type c) override
+        {
+            if (traits_type::eq_int_type(c, traits_type::eof())) {
+                return traits_type::not_eof(c);
+            }
+
+            const auto size{ this->pptr() - this->pbase() };
+            text_.resize(text_.size() * 2); // (May throw std::bad_alloc; The stream then sets badbit.)
+            this->setp(text_.data(), text_.data() + text_.size());
+            this->pbump(static_cast<int>(size));
+
+            *this->pptr() = traits_type::to_char_type(c);
+            this->pbump(1);
+
+            return c;
+        }
+
+    private:
+        String text_{};
+    };
+
+
+    // The stream a message is composed into (reused: Cleared, and its format state reset, between messages).
+    class MessageStream : public Ostream
+    {
+    public:
+        MessageStream() : Ostream(nullptr)
+        {
+            this->rdbuf(&buffer_); // (Also clears badbit.)
+        }
+
+        StringView View() const noexcept
+        {
+            return buffer_.View();
+        }
+
+        String& Text() noexcept
+        {
+            return buffer_.Text();
+        }
+
+        void Resume() noexcept
+        {
+            buffer_.Resume();
+        }
+
+        bool Acquire() noexcept
+        {
+            return !std::exchange(in_use_, true);
+        }
+
+        void Release() noexcept
+        {
+            buffer_.Clear();
+            this->clear();
+            ResetFormat(*this);
+            in_use_ = false;
+        }
+
+    private:
+        MessageBuffer buffer_{};
+        bool in_use_{ false };
+    };
+
+
+    // Returns the calling thread's message stream, acquired; nullptr if it is in use (a LOG statement within
+    // a prefix function or an operator<<) or was already destroyed (a LOG statement during thread exit).
+    static MessageStream* LocalStream() noexcept
+    {
+        thread_local bool destroyed{ false }; // (Trivially destructible: Readable during thread exit.)
+
+        struct LocalMessageStream
+        {
+            MessageStream stream{};
+
+            ~LocalMessageStream()
+            {
+                destroyed = true;
+            }
+        };
+
+        if (destroyed) {
+            return nullptr;
+        }
+
+        thread_local LocalMessageStream local{};
+
+        return local.stream.Acquire() ? &local.stream : nullptr;
+    }
+
+
+    // Points stream_ at the thread's message stream (or at a private one, when that is not available).
+    void AcquireStream()
+    {
+        stream_ = LocalStream();
+
+        if (stream_ == nullptr) {
+            own_stream_ = std::make_unique<MessageStream>();
+            stream_ = own_stream_.get();
+        }
+    }
+
+
+    void ReleaseStream() noexcept
+    {
+        if (stream_ != nullptr && stream_ != own_stream_.get()) {
+            stream_->Release();
+        }
+
+        stream_ = nullptr;
+    }
+
+
+    // Selects the prefix list (see SetPrefixList), instead of prefixes fixed at compile time.
+    struct RuntimePrefixes
+    {
+    };
+
+
+    // The prefixes append straight to the message buffer. (Deferred formatting: To a message
+    // buffer borrowed for the purpose; The prefixes are then captured as a single string.)
+    template <typename PrefixList>
+    void WritePrefixes()
+    {
+        if constexpr (std::is_same_v<PrefixList, RuntimePrefixes>) {
+            if (prefix_function_list_.empty()) {
+                return;
+            }
+        } else if constexpr (PrefixList::kCount == 0) {
+            return;
+        }
+
+        if (deferred_) {
+            AcquireStream();
+        }
+
+        auto& message{ stream_->Text() };
+
+        if constexpr (std::is_same_v<PrefixList, RuntimePrefixes>) {
+            for (const auto& prefix : prefix_function_list_) {
+                prefix(message);
+            }
+        } else {
+            PrefixList::Append(message); // (Direct calls, inlined.)
+        }
+
+        stream_->Resume();
+
+        if (deferred_) {
+            EncodeString(stream_->View());
+            ReleaseStream();
+        }
+    }
+
+
+    // Keeps the calling thread's ring registered with the writer thread for the thread's lifetime.
+    struct ThreadRingHandle
+    {
+        std::shared_ptr<ThreadRing> ring{ nullptr };
+
+        ~ThreadRingHandle()
+        {
+            if (ring) {
+                ring->Orphan();
+            }
+        }
+    };
+
+
+    // kPerThread: Returns the calling thread's ring (registers one on first use, or after the asynchronous mode was restarted).
+    static ThreadRing* LocalRing(AsyncBackend& async_backend)
+    {
+        thread_local ThreadRingHandle handle{};
+
+        if (!handle.ring || handle.ring->Closed()) {
+            if (handle.ring) {
+                handle.ring->Orphan();
+            }
+
+            handle.ring = async_backend.RegisterRing();
+        }
+
+        return handle.ring.get();
+    }
+
+
+    // Asynchronous mode: Hands the composed message over to the writer thread.
+    void EnqueueRecord() noexcept
+    {
+        try {
+            if (deferred_) {
+                if (newline_) {
+                    EncodeArgument(static_cast<CharT>('\n'));
+                }
+            } else {
+                const auto message{ stream_->View() };
+                record_.text.reserve(message.size() + 1);
+                record_.text.assign(message);
+
+                if (newline_) {
+                    record_.text.push_back(static_cast<CharT>('\n'));
+                }
+            }
+
+            // kPerThread: Push into the thread's own ring. (No lock is taken.)
+            if (ring_ != nullptr && ring_->Push(record_)) {
+                return;
+            }
+
+            std::shared_lock lock(mutex_);
+
+            if (async_backend_ && async_backend_->Mode() == QueueMode::kShared) {
+                async_backend_->Push(std::move(record_));
+            } else if (!sinks_.empty()) {
+                // The asynchronous mode was disabled while this message was being composed.
+                std::lock_guard stream_lock(stream_mutex_);
+
+                try {
+                    SinkAdd(record_);
+                    SinkWrite();
+                } catch (...) {
+                    sink_batch_.count = 0;
+                    throw;
+                }
+
+                if (FlushDue(record_.severity)) {
+                    TimedFlush(SinkFlush);
+                }
+            } else if (out_stream_valid_) {
+                // The asynchronous mode was disabled while this message was being composed.
+                std::lock_guard stream_lock(stream_mutex_);
+                std::basic_osyncstream<CharT> out_sync_stream(*out_stream_.get()); // (Own format state. Emits before the lock is released.)
+                WriteRecordCounted(out_sync_stream, record_);
+
+                if (FlushDue(record_.severity)) {
+                    TimedFlush([&out_sync_stream] {
+                        out_sync_stream << std::flush;
+                        out_sync_stream.emit();
+                    });
+                }
+            }
+        } catch (const std::exception& e) {
+            CountDropped(1);
+            ReportException(e);
+        }
+    }
+
+
+    // Writes the message (or hands it over to the writer thread). (The destructor.)
+    void HandOver() noexcept
+    {
+        if (enqueue_ || deferred_) {
+            EnqueueRecord();
+            ReleaseStream();
+            return;
+        }
+
+        // Writing while holding mutex_ (shared) keeps out_stream_ alive, and stream_mutex_
+        // serializes the whole message with the other threads (and the writer thread).
+        std::shared_lock lock(mutex_);
+
+        if (!sinks_.empty()) {
+            std::lock_guard stream_lock(stream_mutex_);
+
+            try {
+                SinkWriteMessage(stream_->View(), newline_, severity_);
+
+                if (FlushDue(severity_)) {
+                    TimedFlush(SinkFlush);
+                }
+            } catch (const std::exception& e) {
+                CountDropped(1);
+                ReportException(e);
+            }
+        } else if (out_stream_valid_) {
+            std::lock_guard stream_lock(stream_mutex_);
+
+            const auto message{ stream_->View() };
+            out_stream_->write(message.data(), static_cast<std::streamsize>(message.size()));
+
+            if (newline_) {
+                out_stream_->put(static_cast<CharT>('\n'));
+            }
+
+            stats_bytes_ += message.size() + (newline_ ? 1 : 0);
+
+            if (FlushDue(severity_)) {
+                TimedFlush([] { out_stream_->flush(); });
+            }
+        }
+
+        ReleaseStream();
+    }
+
+
+    // Writes an argument. (char: Wide characters and strings are transcoded to UTF-8, when actually passed.)
+    template <typename T>
+    static void Put(Ostream& out, const T& value)
+    {
+        if constexpr (std::is_same_v<CharT, char> && std::is_same_v<T, wchar_t>) {
+            PutUtf8(out, std::wstring_view(&value, 1));
+        } else if constexpr (std::is_same_v<CharT, char> && std::is_convertible_v<const T&, std::wstring_view>) {
+            if constexpr (std::is_pointer_v<T>) {
+                if (value == nullptr) {
+                    out.setstate(std::ios_base::badbit); // (As the stream does with a null const char*.)
+                    return;
+                }
+            }
+
+            PutUtf8(out, std::wstring_view(value));
+        } else {
+            out << value;
+        }
+    }
+
+
+    static void PutUtf8(Ostream& out, std::wstring_view text) noexcept
+    {
+        thread_local std::string utf8{}; // (Reused across messages.)
+
+        try {
+            utf8.clear();
+            AppendUtf8(utf8, text);
+
+            out << utf8;
+        } catch (const std::exception&) {
+            out.setstate(std::ios_base::badbit);
+        }
+    }
+
+
+    // Appends text, transcoded to UTF-8 (to a std::string, or anything with push_back(char)). (Invalid code units are replaced.)
+    template <typename Utf8>
+    static void AppendUtf8(Utf8& utf8, std::wstring_view text)
+    {
+        for (size_t i{ 0 }; i < text.size(); ++i) {
+            auto code_point{ static_cast<uint32_t>(static_cast<std::make_unsigned_t<wchar_t>>(text[i])) };
+
+            if constexpr (sizeof(wchar_t) == 2) { // (UTF-16: Combine a surrogate pair.)
+                if (code_point >= 0xD800 && code_point < 0xDC00 && i + 1 < text.size() &&
+                    text[i + 1] >= 0xDC00 && text[i + 1] < 0xE000) {
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (static_cast<uint32_t>(text[++i]) - 0xDC00);
+                }
+            }
+
+            if ((code_point >= 0xD800 && code_point < 0xE000) || code_point > 0x10FFFF) {
+                code_point = 0xFFFD; // (Replacement character.)
+            }
+
+            if (code_point < 0x80) {
+                utf8.push_back(static_cast<char>(code_point));
+            } else if (code_point < 0x800) {
+                utf8.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+                utf8.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            } else if (code_point < 0x10000) {
+                utf8.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+                utf8.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+                utf8.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            } else {
+                utf8.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+                utf8.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+                utf8.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+                utf8.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+        }
+    }
+
+
+    // Counts a written message. True if the flush policy asks for a flush now. (stream_mutex_ held.)
+    static bool FlushDue(Severity severity) noexcept
+    {
+        ++unflushed_messages_;
+
+        return (flush_policy_.messages != 0 && unflushed_messages_ >= flush_policy_.messages) ||
+            (flush_policy_.severity && severity >= *flush_policy_.severity) ||
+            (flush_policy_.interval.count() > 0 && std::chrono::steady_clock::now() - last_flush_ >= flush_policy_.interval);
+    }
+
+
+    // Restarts the flush policy's count and interval. (stream_mutex_ held.)
+    static void Flushed() noexcept
+    {
+        unflushed_messages_ = 0;
+
+        if (flush_policy_.interval.count() > 0) {
+            last_flush_ = std::chrono::steady_clock::now();
+        }
+    }
+
+
+    // Asynchronous mode, before the writer thread sleeps: Flushes the messages written since the last flush once the flush
+    // policy's interval has passed (also when no message follows them). Returns when to call it again (nullopt: Not needed).
+    static std::optional<std::chrono::steady_clock::time_point> FlushOnInterval() noexcept
+    {
+        std::lock_guard lock(stream_mutex_);
+
+        if (flush_policy_.interval.count() <= 0 || unflushed_messages_ == 0) {
+            return std::nullopt;
+        }
+
+        if (const auto deadline{ last_flush_ + flush_policy_.interval }; std::chrono::steady_clock::now() < deadline) {
+            return deadline;
+        }
+
+        FlushStreams();
+        Flushed(); // (Also when the flush failed: Retried with the next message, not in a loop.)
+
+        return std::nullopt;
+    }
+
+
+    // (stream_mutex_ held.)
+    static void FlushStreams() noexcept
+    {
+        try {
+            TimedFlush([] {
+                if (binary_writer_) {
+                    binary_writer_->Flush();
+                }
+
+                SinkFlush();
+
+                if (out_stream_valid_) {
+                    out_stream_->flush();
+                }
+            });
+        } catch (const std::exception& e) {
+            ReportException(e);
+        }
+    }
+
+
+    // Statistics__
+
+    // Per-thread counters: Only the owner thread writes them (GetStats reads them).
+    struct alignas(kCacheLineSize) StatsShard
+    {
+        std::array<std::atomic<uint64_t>, 5> messages{};
+        std::array<std::atomic<uint64_t>, std::tuple_size_v<LatencyHistogram>> enqueue_latency{};
+        uint32_t sampling{ 0 }; // (Owner thread only.)
+        bool owned{ false }; // (Under stats_registry_mutex_.)
+    };
+
+
+    // Owner thread only: A plain increment. (No read-modify-write instruction: The counter is not shared.)
+    static void Increment(std::atomic<uint64_t>& counter) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+
+    static size_t LatencyBucket(std::chrono::steady_clock::duration latency) noexcept
+    {
+        const auto nanoseconds{ std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count() };
+
+        return std::min(static_cast<size_t>(std::bit_width(static_cast<uint64_t>(std::max<int64_t>(nanoseconds, 0)))),
+            std::tuple_size_v<LatencyHistogram> - 1);
+    }
+
+
+    // Returns the calling thread's shard (claims one on first use: Shards are reused, never reset);
+    // nullptr during thread exit (or if out of memory).
+    static StatsShard* LocalStatsShard() noexcept
+    {
+        thread_local bool destroyed{ false }; // (Trivially destructible: Readable during thread exit.)
+
+        struct ShardHandle
+        {
+            StatsShard* shard{ nullptr };
+
+            ~ShardHandle()
+            {
+                destroyed = true;
+
+                if (shard != nullptr) {
+                    std::lock_guard registry_lock(stats_registry_mutex_);
+                    shard->owned = false; // (For the next thread.)
+                }
+            }
+        };
+
+        if (destroyed) {
+            return nullptr;
+        }
+
+        thread_local ShardHandle handle{};
+
+        if (handle.shard == nullptr) {
+            try {
+                std::lock_guard registry_lock(stats_registry_mutex_);
+
+                const auto free_shard{ std::find_if(stats_shards_.begin(), stats_shards_.end(), [](const auto& shard) { return !shard->owned; }) };
+
+                if (free_shard != stats_shards_.end()) {
+                    handle.shard = free_shard->get();
+                } else {
+                    stats_shards_.push_back(std::make_unique<StatsShard>());
+                    handle.shard = stats_shards_.back().get();
+                }
+
+                handle.shard->owned = true;
+            } catch (const std::exception&) {
+                return nullptr;
+            }
+        }
+
+        return handle.shard;
+    }
+
+
+    void CountMessage(Severity severity) noexcept
+    {
+        const auto index{ static_cast<size_t>(severity) };
+
+        if (stats_shard_ != nullptr) {
+            Increment(stats_shard_->messages[index]);
+        } else {
+            stats_fallback_shard_.messages[index].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+
+    // (Dropped by an error. See Stats::dropped_error.)
+    static void CountDropped(size_t count) noexcept
+    {
+        stats_dropped_error_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+
+    // Reports a caught exception to std::cerr (and counts it).
+    static void ReportException(const std::exception& e) noexcept
+    {
+        stats_exceptions_.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "caught exception: " << e.what() << std::endl;
+    }
+
+    // __Statistics
+
+
+    // Sink output__
+
+    // Maximal number of messages per SimpleLogSink::Write(). (IOV_MAX on Linux: A batch fits one writev.)
+    static constexpr size_t kSinkBatchSize{ 1024 };
+
+    struct SinkEntry
+    {
+        std::unique_ptr<SimpleLogSink> sink;
+        Severity min_severity;
+    };
+
+    // The messages of a batch, UTF-8 (Their capacity is kept between batches). Guarded by stream_mutex_.
+    struct SinkBatch
+    {
+        std::array<std::string, kSinkBatchSize> messages{};
+        std::array<std::string_view, kSinkBatchSize> views{};
+        std::array<Severity, kSinkBatchSize> severities{};
+        std::array<std::string_view, kSinkBatchSize> selected{}; // (The views a sink's min_severity lets through.)
+        size_t count{ 0 };
+        Severity min_severity{ Severity::kCritical }; // (Of the messages.)
+    };
+
+
+    // (mutex_ and stream_mutex_ held.)
+    static void UpdateSinksMinSeverity() noexcept
+    {
+        sinks_min_severity_ = Severity::kCritical;
+
+        for (const auto& entry : sinks_) {
+            sinks_min_severity_ = std::min(sinks_min_severity_, entry.min_severity);
+        }
+    }
+
+
+    // Adds a record to the sink batch (writing the batch first, if full), unless no sink takes its severity. (stream_mutex_ held.)
+    static void SinkAdd(Record& record)
+    {
+        if (record.severity < sinks_min_severity_) {
+            return;
+        }
+
+        if (sink_batch_.count == kSinkBatchSize) {
+            SinkWrite();
+        }
+
+        std::string& message{ sink_batch_.messages[sink_batch_.count] };
+
+        if (record.arguments.empty()) {
+            if constexpr (std::is_same_v<CharT, char>) {
+                message.swap(record.text); // (No copy.)
+            } else {
+                message.clear();
+                AppendUtf8(message, record.text);
+            }
+        } else {
+            format_stream_.Release(); // (Clean, even if formatting the previous record threw.)
+            WriteRecord(format_stream_, record);
+            SinkEncode(message, format_stream_.View());
+        }
+
+        sink_batch_.views[sink_batch_.count] = message;
+        sink_batch_.severities[sink_batch_.count] = record.severity;
+        sink_batch_.min_severity = std::min(sink_batch_.min_severity, record.severity);
+        ++sink_batch_.count;
+    }
+
+
+    // Writes the sink batch: To every sink, the messages its min_severity lets through. (stream_mutex_ held.)
+    // The batch is cleared once the sinks return (A crash within a sink's Write leaves it to CrashDump).
+    static void SinkWrite() noexcept
+    {
+        const size_t count{ sink_batch_.count };
+        const Severity min_severity{ sink_batch_.min_severity };
+
+        if (count == 0) {
+            return;
+        }
+
+        for (const auto& entry : sinks_) {
+            if (entry.min_severity <= min_severity) {
+                if (!SinkWriteTo(*entry.sink, { sink_batch_.views.data(), count })) { // (All of them.)
+                    CountDropped(count);
+                }
+
+                continue;
+            }
+
+            size_t selected{ 0 };
+
+            for (size_t i{ 0 }; i < count; ++i) {
+                if (sink_batch_.severities[i] >= entry.min_severity) {
+                    sink_batch_.selected[selected++] = sink_batch_.views[i];
+                }
+            }
+
+            if (selected > 0 && !SinkWriteTo(*entry.sink, { sink_batch_.selected.data(), selected })) {
+                CountDropped(selected);
+            }
+        }
+
+        sink_batch_.count = 0;
+        sink_batch_.min_severity = Severity::kCritical;
+    }
+
+
+    // Writes a single message (a synchronous LOG statement). (stream_mutex_ held.)
+    static void SinkWriteMessage(StringView text, bool newline, Severity severity)
+    {
+        std::string_view views[2]{ {}, "\n" };
+
+        if constexpr (std::is_same_v<CharT, char>) {
+            views[0] = text; // (No copy.)
+        } else {
+            std::string& message{ sink_batch_.messages[0] };
+            SinkEncode(message, text);
+            views[0] = message;
+        }
+
+        for (const auto& entry : sinks_) {
+            if (severity >= entry.min_severity && !SinkWriteTo(*entry.sink, { views, newline ? size_t{ 2 } : size_t{ 1 } })) {
+                CountDropped(1);
+            }
+        }
+    }
+
+
+    // An error of one sink does not keep the messages from the others. Returns false on error (the
+    // messages count as dropped: For this sink).
+    static bool SinkWriteTo(SimpleLogSink& sink, std::span<const std::string_view> messages) noexcept
+    {
+        try {
+            sink.Write(messages);
+
+            for (const auto& message : messages) {
+                stats_bytes_ += message.size();
+            }
+
+            return true;
+        } catch (const std::exception& e) {
+            ReportException(e);
+            return false;
+        }
+    }
+
+
+    // (stream_mutex_ held.)
+    static void SinkFlush() noexcept
+    {
+        for (const auto& entry : sinks_) {
+            try {
+                entry.sink->Flush();
+            } catch (const std::exception& e) {
+                ReportException(e);
+            }
+        }
+    }
+
+
+    static void SinkEncode(std::string& message, StringView text)
+    {
+        message.clear();
+
+        if constexpr (std::is_same_v<CharT, char>) {
+            message.assign(text);
+        } else {
+            AppendUtf8(message, text);
+        }
+    }
+
+    // __Sink output
+
+
+#ifndef _WIN32
+    // Crash handler__
+
+    static constexpr std::array<int, 5> kCrashSignals{ SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+
+    // An alternate stack for the crash handler, set for the current thread while alive (unless the thread has one already).
+    class CrashStack
+    {
+    public:
+
+        CrashStack() noexcept
+        {
+            stack_t previous{};
+
+            if (::sigaltstack(nullptr, &previous) != 0 || (previous.ss_flags & SS_DISABLE) == 0) {
+                return;
+            }
+
+            const size_t size{ std::max<size_t>(SIGSTKSZ, 64 << 10) }; // (SIGSTKSZ is not a constant on every platform.)
+            memory_.reset(new (std::nothrow) char[size]);
+
+            if (memory_ != nullptr) {
+                stack_t stack{};
+                stack.ss_sp = memory_.get();
+                stack.ss_size = size;
+
+                if (::sigaltstack(&stack, nullptr) != 0) {
+                    memory_.reset();
+                }
+            }
+        }
+
+        ~CrashStack()
+        {
+            if (memory_ != nullptr) {
+                stack_t stack{};
+                stack.ss_flags = SS_DISABLE;
+                ::sigaltstack(&stack, nullptr);
+            }
+        }
+
+        CrashStack(const CrashStack&) = delete;
+        CrashStack& operator=(const CrashStack&) = delete;
+
+    private:
+
+        std::unique_ptr<char[]> memory_{};
+    };
+
+    // Preallocated by InstallCrashHandler: The handler allocates nothing.
+    struct CrashState
+    {
+        int fd{ STDERR_FILENO };
+        std::array<struct sigaction, kCrashSignals.size()> previous{}; // (The handlers installed before.)
+        CrashStack stack{}; // (The installing thread's.)
+
+        // The messages of a batch (as the sink batch), and the UTF-8 text of those transcoded:
+        std::array<std::string_view, kSinkBatchSize> views{};
+        std::array<Severity, kSinkBatchSize> severities{};
+        std::array<std::string_view, kSinkBatchSize> selected{};
+        size_t count{ 0 };
+        std::array<char, 64 << 10> text{};
+        size_t text_size{ 0 };
+    };
+
+    // A fixed-size output for AppendUtf8. (The caller makes room: Up to 4 bytes per character.)
+    struct CrashText
+    {
+        char* data;
+        size_t size;
+
+        void push_back(char byte) noexcept
+        {
+            data[size++] = byte;
+        }
+    };
+
+
+    static void CrashHandler(int signal_number) noexcept
+    {
+        // One thread writes out the messages; Another crashing thread waits for it (then the first re-raise ends the process).
+        if (!crash_started_.exchange(true)) {
+            CrashDump();
+            crash_done_.store(true);
+        } else {
+            while (!crash_done_.load()) {}
+        }
+
+        for (size_t i{ 0 }; i < kCrashSignals.size(); ++i) {
+            if (kCrashSignals[i] == signal_number) {
+                ::sigaction(signal_number, &crash_state_->previous[i], nullptr);
+            }
+        }
+
+        ::raise(signal_number); // (Delivered once the handler returns; A fault also recurs then.)
+    }
+
+
+    // Writes the sink batch the writer thread was composing (or writing: A sink may then get some of it twice), then the queued records. (In that order: The order they were logged in.)
+    static void CrashDump() noexcept
+    {
+        CrashState& state{ *crash_state_ };
+
+        for (size_t i{ 0 }; i < std::min(sink_batch_.count, kSinkBatchSize); ++i) {
+            CrashAdd(sink_batch_.views[i], sink_batch_.severities[i]);
+        }
+
+        if (const AsyncBackend* const async_backend{ async_backend_.get() }) {
+            async_backend->ForEachQueued([&state](const Record& record) {
+                StringView text{ record.text };
+
+                if constexpr (std::is_same_v<CharT, char>) {
+                    CrashAdd(text, record.severity); // (No copy.)
+                } else {
+                    // (Written out before transcoding, not by CrashAdd: Writing the batch reuses the text buffer.)
+                    if (state.count == kSinkBatchSize || (state.text.size() - state.text_size) / 4 < text.size()) {
+                        CrashWriteBatch();
+                        text = text.substr(0, state.text.size() / 4); // (Truncates a longer message.)
+                    }
+
+                    CrashText utf8{ state.text.data() + state.text_size, 0 };
+                    AppendUtf8(utf8, text);
+                    CrashAdd({ utf8.data, utf8.size }, record.severity);
+                    state.text_size += utf8.size;
+                }
+
+                if (!record.arguments.empty()) {
+                    CrashAdd(" (deferred arguments left out)\n", record.severity);
+                }
+            });
+        }
+
+        CrashWriteBatch(); // (Also without messages: The sinks write what they buffer.)
+    }
+
+
+    static void CrashAdd(std::string_view message, Severity severity) noexcept
+    {
+        CrashState& state{ *crash_state_ };
+
+        if (state.count == kSinkBatchSize) {
+            CrashWriteBatch();
+        }
+
+        state.views[state.count] = message;
+        state.severities[state.count] = severity;
+        ++state.count;
+    }
+
+
+    static void CrashWriteBatch() noexcept
+    {
+        CrashState& state{ *crash_state_ };
+
+        if (sinks_.empty()) {
+            for (size_t i{ 0 }; i < state.count; ++i) {
+                for (std::string_view rest{ state.views[i] }; !rest.empty();) {
+                    const ssize_t written{ ::write(state.fd, rest.data(), rest.size()) };
+
+                    if (written < 0 && errno != EINTR) {
+                        break;
+                    }
+
+                    rest.remove_prefix(written > 0 ? static_cast<size_t>(written) : 0);
+                }
+            }
+        } else {
+            for (const auto& entry : sinks_) {
+                size_t selected{ 0 };
+
+                for (size_t i{ 0 }; i < state.count; ++i) {
+                    if (state.severities[i] >= entry.min_severity) {
+                        state.selected[selected++] = state.views[i];
+                    }
+                }
+
+                entry.sink->CrashWrite({ state.selected.data(), selected });
+            }
+        }
+
+        state.count = 0;
+        state.text_size = 0;
+    }
+
+    // __Crash handler
+#endif
+
+
+    // Writes a record, and counts its characters (see Stats). Deferred arguments are formatted into
+    // format_stream_ first, to be counted. (stream_mutex_ held.)
+    static void WriteRecordCounted(Ostream& out, const Record& record)
+    {
+        if (record.arguments.empty()) {
+            out << record.text;
+            stats_bytes_ += record.text.size();
+            return;
+        }
+
+        format_stream_.Release(); // (Clean, even if formatting the previous record threw.)
+        WriteRecord(format_stream_, record);
+
+        const auto text{ format_stream_.View() };
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        stats_bytes_ += text.size();
+    }
+
+
+    // Flushes (flush), and records how long it took (see Stats). (stream_mutex_ held.)
+    template <typename FlushFunction>
+    static void TimedFlush(FlushFunction flush)
+    {
+        const auto begin{ std::chrono::steady_clock::now() };
+        flush();
+        ++stats_flush_latency_[LatencyBucket(std::chrono::steady_clock::now() - begin)];
+
+        Flushed();
+    }
+
+
+    // Writes a record, formatting its deferred arguments (if any).
+    static void WriteRecord(Ostream& out, const Record& record)
+    {
+        if (!record.text.empty()) {
+            out << record.text;
+        }
+
+        if (!record.arguments.empty()) {
+            DecodeArguments(record.arguments, out);
+        }
+    }
+
+
+    // Every message used to be formatted on a fresh stream: Restores the default format state.
+    static void ResetFormat(std::basic_ios<CharT>& stream)
+    {
+        stream.flags(std::ios_base::skipws | std::ios_base::dec);
+        stream.precision(6);
+        stream.width(0);
+        stream.fill(stream.widen(' '));
+    }
+
+
+    // Deferred formatting__
+
+    // Formats one captured argument into out, and advances data past it.
+    using DecodeFunction = void (*)(const char*& data, Ostream& out);
+
+    // The argument types, as identified in the binary output.
+    enum class ArgumentType : uint8_t {
+        kBool, kChar, kSignedChar, kUnsignedChar, kWideChar, kShort, kUnsignedShort, kInt, kUnsignedInt,
+        kLong, kUnsignedLong, kLongLong, kUnsignedLongLong, kFloat, kDouble, kLongDouble, // Arithmetic (captured as is).
+        kPointer, // (Printed as an address.)
+        kWideString, kNarrowString, // (Captured by content.)
+        kFormat, // Stream manipulators (std::hex, std::setw...).
+        kSeverity // The severity label.
+    };
+
+    // Compile-time generated per argument type; Every captured argument is preceded by a pointer to its codec.
+    struct ArgumentCodec
+    {
+        DecodeFunction decode;
+        ArgumentType type;
+        size_t size; // Of the captured bytes. (Strings: Of the length; The characters follow.)
+    };
+
+    // Initial capacity of the captured arguments buffer.
+    static constexpr size_t kArgumentsReserve{ 256 };
+
+    // Format manipulators (from <iomanip>) that are captured as they are.
+    template <typename T>
+    static constexpr bool kIsFormatManipulator{
+        std::is_trivially_copyable_v<T> && (
+            std::is_same_v<T, decltype(std::setw(0))> ||
+            std::is_same_v<T, decltype(std::setprecision(0))> ||
+            std::is_same_v<T, decltype(std::setbase(0))> ||
+            std::is_same_v<T, decltype(std::setfill(static_cast<CharT>(' ')))> ||
+            std::is_same_v<T, decltype(std::setiosflags(std::ios_base::fmtflags{}))> ||
+            std::is_same_v<T, decltype(std::resetiosflags(std::ios_base::fmtflags{}))>) };
+
+
+    template <typename T>
+    static constexpr ArgumentType TypeOf()
+    {
+        if constexpr (std::is_same_v<T, bool>) { return ArgumentType::kBool; }
+        else if constexpr (std::is_same_v<T, char>) { return ArgumentType::kChar; }
+        else if constexpr (std::is_same_v<T, signed char>) { return ArgumentType::kSignedChar; }
+        else if constexpr (std::is_same_v<T, unsigned char>) { return ArgumentType::kUnsignedChar; }
+        else if constexpr (std::is_same_v<T, wchar_t>) { return ArgumentType::kWideChar; }
+        else if constexpr (std::is_same_v<T, short>) { return ArgumentType::kShort; }
+        else if constexpr (std::is_same_v<T, unsigned short>) { return ArgumentType::kUnsignedShort; }
+        else if constexpr (std::is_same_v<T, int>) { return ArgumentType::kInt; }
+        else if constexpr (std::is_same_v<T, unsigned int>) { return ArgumentType::kUnsignedInt; }
+        else if constexpr (std::is_same_v<T, long>) { return ArgumentType::kLong; }
+        else if constexpr (std::is_same_v<T, unsigned long>) { return ArgumentType::kUnsignedLong; }
+        else if constexpr (std::is_same_v<T, long long>) { return ArgumentType::kLongLong; }
+        else if constexpr (std::is_same_v<T, unsigned long long>) { return ArgumentType::kUnsignedLongLong; }
+        else if constexpr (std::is_same_v<T, float>) { return ArgumentType::kFloat; }
+        else if constexpr (std::is_same_v<T, double>) { return ArgumentType::kDouble; }
+        else if constexpr (std::is_same_v<T, long double>) { return ArgumentType::kLongDouble; }
+        else if constexpr (std::is_pointer_v<T> && !std::is_function_v<std::remove_pointer_t<T>>) { return ArgumentType::kPointer; }
+        else { return ArgumentType::kFormat; }
+    }
+
+
+    // Captures an argument: Codec pointer, followed by the argument's bytes.
+    // (Strings are captured by content, as the pointed-to characters may not outlive the LOG statement.)
+    template <typename T>
+    void EncodeArgument(const T& value)
+    {
+        if constexpr (std::is_convertible_v<const T&, std::wstring_view>) { // (const wchar_t*, wchar_t[N], std::wstring...)
+            if constexpr (std::is_pointer_v<T>) {
+                if (value == nullptr) {
+                    return;
+                }
+            }
+
+            EncodeString(std::wstring_view(value));
+        } else if constexpr (std::is_convertible_v<const T&, const char*>) { // (const char*, char[N])
+            const char* const text{ value };
+
+            if (text != nullptr) {
+                EncodeString(std::string_view(text));
+            }
+        } else if constexpr (std::is_same_v<CharT, char> && std::is_convertible_v<const T&, std::string_view>) { // (UTF-8: std::string...)
+            EncodeString(std::string_view(value));
+        } else if constexpr (std::is_function_v<T>) { // Stream manipulators (std::hex, std::boolalpha...).
+            EncodeValue<T*>(&value);
+        } else if constexpr (std::is_arithmetic_v<T> || std::is_pointer_v<T> || kIsFormatManipulator<T>) {
+            EncodeValue<T>(value);
+        } else {
+            // Any other type: Format now, capture the text.
+            std::basic_ostringstream<CharT> text_stream{};
+            text_stream << value;
+            EncodeString(text_stream.view());
+        }
+    }
+
+
+    template <typename T>
+    void EncodeValue(const T& value)
+    {
+        EncodeBytes(kValueCodec<T>, &value, sizeof(T));
+    }
+
+
+    template <typename StringCharT>
+    void EncodeString(std::basic_string_view<StringCharT> text)
+    {
+        const size_t length{ text.size() };
+        const size_t offset{ EncodeBytes(kStringCodec<StringCharT>, &length, sizeof(length)) };
+
+        record_.arguments.resize(offset + length * sizeof(StringCharT));
+        std::memcpy(record_.arguments.data() + offset, text.data(), length * sizeof(StringCharT));
+    }
+
+
+    void EncodeSeverity(Severity severity)
+    {
+        static constexpr ArgumentCodec kSeverityCodec{ &DecodeSeverity, ArgumentType::kSeverity, sizeof(Severity) };
+
+        EncodeBytes(kSeverityCodec, &severity, sizeof(severity));
+    }
+
+
+    // Appends the codec pointer and size bytes. Returns the offset past them.
+    size_t EncodeBytes(const ArgumentCodec& codec, const void* bytes, size_t size)
+    {
+        const ArgumentCodec* const codec_pointer{ &codec };
+        const size_t offset{ record_.arguments.size() };
+
+        record_.arguments.resize(offset + sizeof(codec_pointer) + size);
+        std::memcpy(record_.arguments.data() + offset, &codec_pointer, sizeof(codec_pointer));
+        std::memcpy(record_.arguments.data() + offset + sizeof(codec_pointer), bytes, size);
+
+        return offset + sizeof(codec_pointer) + size;
+    }
+
+
+    template <typename T>
+    static void DecodeValue(const char*& data, Ostream& out)
+    {
+        std::array<char, sizeof(T)> bytes{};
+        std::memcpy(bytes.data(), data, sizeof(T));
+        data += sizeof(T);
+
+        Put(out, std::bit_cast<T>(bytes));
+    }
+
+
+    template <typename StringCharT>
+    static void DecodeString(const char*& data, Ostream& out)
+    {
+        size_t length{ 0 };
+        std::memcpy(&length, data, sizeof(length));
+        data += sizeof(length);
+
+        WriteString<StringCharT>(data, length, out);
+        data += length * sizeof(StringCharT);
+    }
+
+
+    // The codecs (declared after the decode functions they point to):
+    template <typename T>
+    static constexpr ArgumentCodec kValueCodec{ &DecodeValue<T>, TypeOf<T>(), sizeof(T) };
+
+    template <typename StringCharT>
+    static constexpr ArgumentCodec kStringCodec{ &DecodeString<StringCharT>,
+        std::is_same_v<StringCharT, wchar_t> ? ArgumentType::kWideString : ArgumentType::kNarrowString, sizeof(size_t) };
+
+
+    // Writes length characters (unaligned) as a string argument of this character type would be written.
+    template <typename StringCharT>
+    static void WriteString(const char* data, size_t length, Ostream& out)
+    {
+        thread_local std::basic_string<StringCharT> text{}; // (Writer thread. Reused across messages.)
+
+        text.resize(length);
+        std::memcpy(text.data(), data, length * sizeof(StringCharT));
+
+        if constexpr (std::is_same_v<StringCharT, CharT>) {
+            out << text;
+        } else if constexpr (std::is_same_v<StringCharT, wchar_t>) {
+            Put(out, std::wstring_view(text)); // (Transcoded to UTF-8, as is a wide argument.)
+        } else {
+            out << text.c_str(); // (Widened by the stream, as is a const char* argument.)
+        }
+    }
+
+
+    static void DecodeSeverity(const char*& data, Ostream& out)
+    {
+        Severity severity{ Severity::kDebug };
+        std::memcpy(&severity, data, sizeof(severity));
+        data += sizeof(severity);
+
+        out << kSeverityHeaders.at(static_cast<size_t>(severity));
+    }
+
+
+    // Formats all captured arguments of a message.
+    static void DecodeArguments(const std::string& arguments, Ostream& out)
+    {
+        const char* data{ arguments.data() };
+        const char* const end{ data + arguments.size() };
+
+        while (data < end) {
+            const ArgumentCodec* codec{ nullptr };
+            std::memcpy(&codec, data, sizeof(codec));
+            data += sizeof(codec);
+
+            codec->decode(data, out);
+        }
+
+        ResetFormat(out);
+    }
+
+    // __Deferred formatting
+
+
+    // Binary output__
+
+    // File layout (all integers little-endian, "varint": LEB128; Signed values zigzag-encoded):
+    //   Header: "SLOGBIN1", version (u8), sizeof(wchar_t), sizeof(long), sizeof(long double) (u8 each),
+    //           4 reserved bytes, base timestamp (i64; Nanoseconds since the epoch).
+    //   Frames: length (varint) + payload. Payload:
+    //     kCallsite: id (varint), line (varint), file name length (varint) + file name, argument count (varint) + types (u8 each).
+    //     kRecord: callsite id (varint), timestamp delta (signed varint), arguments.
+    //   Arguments: Arithmetic: As is. Pointer: u64. Format: flags (varint, see kFormatFlags), width, precision (signed varints),
+    //              fill (u32). Severity: u8. Strings: 0 (varint) if equal to the string of this argument in the callsite's
+    //              previous record (a literal, typically), else length + 1 (varint) + characters (wchar_t: Varint each).
+    static constexpr std::string_view kBinaryMagic{ "SLOGBIN1" };
+    static constexpr uint8_t kBinaryVersion{ 1 };
+    static constexpr size_t kBinaryHeaderSize{ 24 };
+
+    enum class FrameType : uint8_t { kCallsite, kRecord };
+
+    // The format flags in the binary output (bit i: kFormatFlags[i]), as their values are implementation-defined.
+    static constexpr std::array<std::ios_base::fmtflags, 15> kFormatFlags{
+        std::ios_base::boolalpha, std::ios_base::dec, std::ios_base::fixed, std::ios_base::hex, std::ios_base::internal,
+        std::ios_base::left, std::ios_base::oct, std::ios_base::right, std::ios_base::scientific, std::ios_base::showbase,
+        std::ios_base::showpoint, std::ios_base::showpos, std::ios_base::skipws, std::ios_base::unitbuf, std::ios_base::uppercase };
+
+
+    static void AppendVarint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+
+        out.push_back(static_cast<char>(value));
+    }
+
+
+    static void AppendSignedVarint(std::string& out, int64_t value)
+    {
+        AppendVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63)); // (Zigzag.)
+    }
+
+
+    static uint64_t ReadVarint(const char*& data, const char* end)
+    {
+        uint64_t value{ 0 };
+
+        for (int shift{ 0 }; shift < 64; shift += 7) {
+            if (data == end) {
+                break;
+            }
+
+            const auto byte{ static_cast<uint8_t>(*data++) };
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+
+        throw std::runtime_error("malformed binary log: truncated varint");
+    }
+
+
+    static int64_t ReadSignedVarint(const char*& data, const char* end)
+    {
+        const uint64_t value{ ReadVarint(data, end) };
+
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+
+    // Translates records into binary frames (writer thread; Guarded by stream_mutex_).
+    class BinaryWriter
+    {
+    public:
+
+        explicit BinaryWriter(std::unique_ptr<std::ostream> out_stream) :
+            out_stream_(std::move(out_stream)),
+            timestamp_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count())
+        {
+            std::string header{ kBinaryMagic };
+            header.push_back(static_cast<char>(kBinaryVersion));
+            header.push_back(static_cast<char>(sizeof(wchar_t)));
+            header.push_back(static_cast<char>(sizeof(long)));
+            header.push_back(static_cast<char>(sizeof(long double)));
+            header.append(4, '\0');
+            AppendFixed(header, timestamp_);
+
+            out_stream_->write(header.data(), static_cast<std::streamsize>(header.size()));
+            out_stream_->flush();
+        }
+
+
+        void Write(const Record& record)
+        {
+            payload_.clear();
+            types_.clear();
+
+            if (record.arguments.empty()) {
+                // A composed message: One string (of CharT).
+                constexpr bool wide{ std::is_same_v<CharT, wchar_t> };
+                types_.push_back(wide ? ArgumentType::kWideString : ArgumentType::kNarrowString);
+                CallsiteState& callsite{ Callsite(record.location) };
+                AppendString(callsite.strings[0], reinterpret_cast<const char*>(record.text.data()), record.text.size(), wide);
+            } else {
+                CollectTypes(record.arguments);
+                TranslateArguments(record.arguments, Callsite(record.location));
+            }
+
+            frame_.clear();
+            frame_.push_back(static_cast<char>(FrameType::kRecord));
+            AppendVarint(frame_, callsite_id_);
+            AppendSignedVarint(frame_, record.timestamp - timestamp_);
+            frame_.append(payload_);
+            WriteFrame();
+
+            timestamp_ = record.timestamp;
+        }
+
+
+        void Flush()
+        {
+            out_stream_->flush();
+        }
+
+    private:
+
+        struct CallsiteState
+        {
+            uint64_t id;
+            std::vector<std::string> strings; // The string arguments (bytes) of the previous record, by argument index.
+        };
+
+
+        void CollectTypes(const std::string& arguments)
+        {
+            const char* data{ arguments.data() };
+            const char* const end{ data + arguments.size() };
+
+            while (data < end) {
+                const ArgumentCodec* codec{ nullptr };
+                std::memcpy(&codec, data, sizeof(codec));
+                data += sizeof(codec);
+
+                types_.push_back(codec->type);
+
+                if (codec->type == ArgumentType::kWideString || codec->type == ArgumentType::kNarrowString) {
+                    size_t length{ 0 };
+                    std::memcpy(&length, data, sizeof(length));
+                    data += sizeof(length) + length * (codec->type == ArgumentType::kWideString ? sizeof(wchar_t) : sizeof(char));
+                } else {
+                    data += codec->size;
+                }
+            }
+        }
+
+
+        // Re-encodes the captured arguments in their portable form.
+        void TranslateArguments(const std::string& arguments, CallsiteState& callsite)
+        {
+            ResetFormat(probe_);
+
+            const char* data{ arguments.data() };
+            const char* const end{ data + arguments.size() };
+
+            for (size_t index{ 0 }; data < end; ++index) {
+                const ArgumentCodec* codec{ nullptr };
+                std::memcpy(&codec, data, sizeof(codec));
+                data += sizeof(codec);
+
+                switch (codec->type) {
+                case ArgumentType::kWideString:
+                case ArgumentType::kNarrowString: {
+                    const bool wide{ codec->type == ArgumentType::kWideString };
+                    size_t length{ 0 };
+                    std::memcpy(&length, data, sizeof(length));
+                    data += sizeof(length);
+
+                    AppendString(callsite.strings[index], data, length, wide);
+                    data += length * (wide ? sizeof(wchar_t) : sizeof(char));
+                    probe_.width(0); // (Output resets the width.)
+                    break;
+                }
+                case ArgumentType::kPointer: {
+                    uintptr_t address{ 0 };
+                    std::memcpy(&address, data, sizeof(address));
+                    data += sizeof(address);
+                    AppendFixed(payload_, static_cast<uint64_t>(address));
+                    probe_.width(0);
+                    break;
+                }
+                case ArgumentType::kFormat: {
+                    // Apply the manipulator to the probe stream, then record the resulting format state.
+                    codec->decode(data, probe_);
+
+                    uint64_t flags{ 0 };
+
+                    for (size_t i{ 0 }; i < kFormatFlags.size(); ++i) {
+                        if ((probe_.flags() & kFormatFlags[i]) != 0) {
+                            flags |= uint64_t{ 1 } << i;
+                        }
+                    }
+
+                    AppendVarint(payload_, flags);
+                    AppendSignedVarint(payload_, probe_.width());
+                    AppendSignedVarint(payload_, probe_.precision());
+                    AppendFixed(payload_, static_cast<uint32_t>(probe_.fill()));
+                    break;
+                }
+                default: // (Arithmetic, severity.)
+                    AppendChars(payload_, data, codec->size);
+                    data += codec->size;
+                    probe_.width(0);
+                    break;
+                }
+            }
+        }
+
+
+        // Returns the callsite of (location, types_), describing the callsite first if it is new.
+        CallsiteState& Callsite(const std::source_location& location)
+        {
+            key_.assign(reinterpret_cast<const char*>(types_.data()), types_.size());
+            AppendVarint(key_, location.line());
+            AppendVarint(key_, location.column());
+            key_.append(location.file_name());
+
+            const auto found{ callsites_.find(key_) };
+
+            if (found != callsites_.end()) {
+                callsite_id_ = found->second.id;
+                return found->second;
+            }
+
+            callsite_id_ = callsites_.size();
+            const std::string_view file_name{ location.file_name() };
+
+            frame_.clear();
+            frame_.push_back(static_cast<char>(FrameType::kCallsite));
+            AppendVarint(frame_, callsite_id_);
+            AppendVarint(frame_, location.line());
+            AppendVarint(frame_, file_name.size());
+            frame_.append(file_name);
+            AppendVarint(frame_, types_.size());
+            AppendChars(frame_, types_.data(), types_.size());
+            WriteFrame();
+
+            return callsites_.emplace(key_, CallsiteState{ callsite_id_, std::vector<std::string>(types_.size()) }).first->second;
+        }
+
+
+        // Appends a string argument (see the file layout), remembering it as the callsite's previous one.
+        void AppendString(std::string& previous, const char* data, size_t length, bool wide)
+        {
+            const size_t size{ length * (wide ? sizeof(wchar_t) : sizeof(char)) };
+
+            if (previous.size() == size && std::memcmp(previous.data(), data, size) == 0) {
+                AppendVarint(payload_, 0);
+                return;
+            }
+
+            previous.assign(data, size);
+            AppendVarint(payload_, length + 1);
+
+            if (!wide) {
+                AppendChars(payload_, data, size);
+                return;
+            }
+
+            // (Characters as varints: ASCII takes one byte, instead of sizeof(wchar_t).)
+            for (size_t i{ 0 }; i < length; ++i) {
+                wchar_t character{};
+                std::memcpy(&character, data + i * sizeof(wchar_t), sizeof(character));
+                AppendVarint(payload_, static_cast<std::make_unsigned_t<wchar_t>>(character));
+            }
+        }
+
+
+        void WriteFrame()
+        {
+            length_.clear();
+            AppendVarint(length_, frame_.size());
+
+            out_stream_->write(length_.data(), static_cast<std::streamsize>(length_.size()));
+            out_stream_->write(frame_.data(), static_cast<std::streamsize>(frame_.size()));
+            stats_bytes_ += length_.size() + frame_.size();
+        }
+
+
+        template <typename T>
+        static void AppendFixed(std::string& out, T value)
+        {
+            for (size_t i{ 0 }; i < sizeof(T); ++i) {
+                out.push_back(static_cast<char>(static_cast<uint64_t>(value) >> (8 * i)));
+            }
+        }
+
+
+        static void AppendChars(std::string& out, const void* data, size_t size)
+        {
+            out.append(static_cast<const char*>(data), size);
+        }
+
+
+        std::unique_ptr<std::ostream> out_stream_;
+        int64_t timestamp_; // Of the previous record.
+        std::unordered_map<std::string, CallsiteState> callsites_{};
+        uint64_t callsite_id_{ 0 }; // (Of the current record.)
+        Ostream probe_{ nullptr }; // (Only its format state is used.)
+
+        // (Reused across records.)
+        std::string payload_{};
+        std::string frame_{};
+        std::string length_{};
+        std::string key_{};
+        std::vector<ArgumentType> types_{};
+    };
+
+    // Formats one argument of a binary record into out, and advances data past it.
+    // (previous: The string of this argument in the callsite's previous record.)
+    static void DecodeBinaryArgument(ArgumentType type, const char*& data, const char* end, std::string& previous, Ostream& out)
+    {
+        const auto require{ [&data, end](uint64_t size) {
+            if (static_cast<uint64_t>(end - data) < size) {
+                throw std::runtime_error("malformed binary log: truncated record");
+            }
+        } };
+
+        const auto decode_value{ [&]<typename T>(T*) {
+            require(sizeof(T));
+            DecodeValue<T>(data, out);
+        } };
+
+        switch (type) {
+        case ArgumentType::kBool: decode_value(static_cast<bool*>(nullptr)); break;
+        case ArgumentType::kChar: decode_value(static_cast<char*>(nullptr)); break;
+        case ArgumentType::kSignedChar: decode_value(static_cast<signed char*>(nullptr)); break;
+        case ArgumentType::kUnsignedChar: decode_value(static_cast<unsigned char*>(nullptr)); break;
+        case ArgumentType::kWideChar: decode_value(static_cast<wchar_t*>(nullptr)); break;
+        case ArgumentType::kShort: decode_value(static_cast<short*>(nullptr)); break;
+        case ArgumentType::kUnsignedShort: decode_value(static_cast<unsigned short*>(nullptr)); break;
+        case ArgumentType::kInt: decode_value(static_cast<int*>(nullptr)); break;
+        case ArgumentType::kUnsignedInt: decode_value(static_cast<unsigned int*>(nullptr)); break;
+        case ArgumentType::kLong: decode_value(static_cast<long*>(nullptr)); break;
+        case ArgumentType::kUnsignedLong: decode_value(static_cast<unsigned long*>(nullptr)); break;
+        case ArgumentType::kLongLong: decode_value(static_cast<long long*>(nullptr)); break;
+        case ArgumentType::kUnsignedLongLong: decode_value(static_cast<unsigned long long*>(nullptr)); break;
+        case ArgumentType::kFloat: decode_value(static_cast<float*>(nullptr)); break;
+        case ArgumentType::kDouble: decode_value(static_cast<double*>(nullptr)); break;
+        case ArgumentType::kLongDouble: decode_value(static_cast<long double*>(nullptr)); break;
+
+        case ArgumentType::kPointer: {
+            require(sizeof(uint64_t));
+            Put(out, reinterpret_cast<const void*>(static_cast<uintptr_t>(ReadFixed<uint64_t>(data))));
+            break;
+        }
+        case ArgumentType::kWideString: {
+            const uint64_t length_plus_one{ ReadVarint(data, end) };
+
+            if (length_plus_one != 0) {
+                require(length_plus_one - 1); // (At least one byte per character.)
+                previous.resize(static_cast<size_t>(length_plus_one - 1) * sizeof(wchar_t));
+
+                for (size_t i{ 0 }; i < previous.size(); i += sizeof(wchar_t)) {
+                    const auto character{ static_cast<wchar_t>(ReadVarint(data, end)) };
+                    std::memcpy(previous.data() + i, &character, sizeof(character));
+                }
+            }
+
+            WriteString<wchar_t>(previous.data(), previous.size() / sizeof(wchar_t), out);
+            break;
+        }
+        case ArgumentType::kNarrowString: {
+            const uint64_t length_plus_one{ ReadVarint(data, end) };
+
+            if (length_plus_one != 0) {
+                require(length_plus_one - 1);
+                previous.assign(data, static_cast<size_t>(length_plus_one - 1));
+                data += length_plus_one - 1;
+            }
+
+            WriteString<char>(previous.data(), previous.size(), out);
+            break;
+        }
+        case ArgumentType::kFormat: {
+            const uint64_t flags{ ReadVarint(data, end) };
+            const int64_t width{ ReadSignedVarint(data, end) };
+            const int64_t precision{ ReadSignedVarint(data, end) };
+            require(sizeof(uint32_t));
+            const uint32_t fill{ ReadFixed<uint32_t>(data) };
+
+            std::ios_base::fmtflags format_flags{};
+
+            for (size_t i{ 0 }; i < kFormatFlags.size(); ++i) {
+                if ((flags & (uint64_t{ 1 } << i)) != 0) {
+                    format_flags |= kFormatFlags[i];
+                }
+            }
+
+            out.flags(format_flags);
+            out.width(static_cast<std::streamsize>(width));
+            out.precision(static_cast<std::streamsize>(precision));
+            out.fill(static_cast<CharT>(fill));
+            break;
+        }
+        case ArgumentType::kSeverity: {
+            require(sizeof(Severity));
+            DecodeSeverity(data, out);
+            break;
+        }
+        default:
+            throw std::runtime_error("malformed binary log: unknown argument type");
+        }
+    }
+
+
+    template <typename T>
+    static T ReadFixed(const char*& data)
+    {
+        uint64_t value{ 0 };
+
+        for (size_t i{ 0 }; i < sizeof(T); ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(*data++)) << (8 * i);
+        }
+
+        return static_cast<T>(value);
+    }
+
+    // __Binary output
+
+
+    const Severity severity_;
+    bool newline_{ true };
+
+    // The calling thread's counters (see GetStats). nullptr: stats_fallback_shard_.
+    StatsShard* stats_shard_{ nullptr };
+
+    // The stream the current message is composed into (nullptr if there is nothing to log to):
+    // The thread's message stream, or own_stream_ when that is in use.
+    MessageStream* stream_{ nullptr };
+    std::unique_ptr<MessageStream> own_stream_{ nullptr };
+
+    // Asynchronous mode: The destructor hands the composed message over to the writer thread.
+    bool enqueue_{ false };
+
+    // Asynchronous mode, kPerThread: The ring of the thread that composes the message.
+    ThreadRing* ring_{ nullptr };
+
+    // Asynchronous mode: The record handed over to the writer thread.
+    Record record_{};
+
+    // Deferred formatting: The arguments are captured into record_.arguments (see EncodeArgument).
+    bool deferred_{ false };
+
+    // Statics__
+
+    // Shared among all instances of the SimpleLogger class across the entire process.
+    // Even if there are no instances of the class SimpleLogger in existence, the static member  
+    // variables will still exist and retain their values until the program terminates.
+
+    // The prefix functions (pointers):
+    inline static std::vector<PrefixAppender> prefix_function_list_{};
+
+    // Asynchronous mode: Defer the formatting to the writer thread.
+    inline static bool deferred_formatting_{ false };
+
+    // Asynchronous mode: Binary output (nullptr: Text).
+    inline static std::unique_ptr<BinaryWriter> binary_writer_{ nullptr };
+
+    // Output Stream:
+    inline static std::unique_ptr<Ostream> out_stream_{ nullptr };
+    inline static bool out_stream_valid_{ false };
+
+    // Sinks (None: The out stream), and their batch (Guarded by stream_mutex_):
+    inline static std::vector<SinkEntry> sinks_{};
+    inline static Severity sinks_min_severity_{ Severity::kDebug }; // (The lowest min_severity of the sinks.)
+    inline static SinkBatch sink_batch_{};
+
+    // Formats deferred arguments on the writer's side (for the sinks, and to count the text). Guarded by stream_mutex_.
+    inline static MessageStream format_stream_{};
+
+    // Statistics (see GetStats):
+    inline static std::vector<std::unique_ptr<StatsShard>> stats_shards_{}; // (Never shrinks: A shard's address is stable.)
+    inline static std::mutex stats_registry_mutex_{}; // (Taken once per thread, and by GetStats.)
+    inline static StatsShard stats_fallback_shard_{}; // (Threads in exit. Atomic increments.)
+    inline static uint64_t stats_bytes_{ 0 }; // (Guarded by stream_mutex_.)
+    inline static LatencyHistogram stats_flush_latency_{}; // (Guarded by stream_mutex_.)
+    inline static std::atomic<uint64_t> stats_dropped_backpressure_{ 0 };
+    inline static std::atomic<uint64_t> stats_dropped_error_{ 0 };
+    inline static std::atomic<uint64_t> stats_exceptions_{ 0 };
+    inline static std::atomic<uint64_t> stats_queue_high_water_{ 0 };
+
+    // By severity (see SetBackpressure). Read by the producers when the queue is full.
+    inline static std::array<std::atomic<Backpressure>, 5> backpressure_{};
+
+#ifndef _WIN32
+    // Crash handler (see InstallCrashHandler):
+    inline static CrashState* crash_state_{ nullptr };
+    inline static std::atomic<bool> crash_started_{ false };
+    inline static std::atomic<bool> crash_done_{ false };
+#endif
+
+    // Flush policy, and its state (Guarded by stream_mutex_):
+    inline static FlushPolicy flush_policy_{};
+    inline static size_t unflushed_messages_{ 0 };
+    inline static std::chrono::steady_clock::time_point last_flush_{};
+
+    // Synchronizes access to all static member variables:
+    // Allows multiple threads to concurrently read shared resources
+    // while preventing concurrent writes or read and write operations.
+    // Predominantly read: A reader only writes its own thread's slot (no cache line bounces between logging threads).
+    inline static ConfigMutex mutex_{};
+
+    // Serializes the writes to out_stream_ (messages, the writer thread, SetOstream). (The writer thread never takes mutex_, so
+    // producers that wait for room in the queue while holding mutex_ can not deadlock it.)
+    inline static std::mutex stream_mutex_{};
+
+    // Asynchronous mode (nullptr when synchronous):
+    // (Reset at exit by DisableAsync, registered with std::atexit: Static destruction order alone does not guarantee that
+    // the writer thread's drain still finds out_stream_, sinks_ and format_stream_ alive.)
+    inline static std::unique_ptr<AsyncBackend> async_backend_{ nullptr };
+    inline static bool exit_drain_registered_{ false }; // (Guarded by mutex_.)
+
+    // __Statics
+};
+
+
+using SimpleLogger = BasicSimpleLogger<wchar_t>;
+using Utf8SimpleLogger = BasicSimpleLogger<char>;
+
+
+// Compile-time prefix pipeline__
+
+// A prefix chain fixed at compile time: Every PrefixType has a static Append(std::basic_string<CharT>& message).
+template <typename... PrefixTypes>
+struct Prefixes
+{
+    static constexpr size_t kCount{ sizeof...(PrefixTypes) };
+
+    template <typename CharT>
+    static void Append(std::basic_string<CharT>& message)
+    {
+        (PrefixTypes::Append(message), ...);
+    }
+};
+
+
+// A logger whose prefixes are fixed at compile time (fully inlined; No std::function, no prefix list).
+// Everything else (out stream, asynchronous mode...) is shared with BasicSimpleLogger<CharT>. Example:
+//   using AppLogger = SimpleLoggerT<Prefixes<TimePrefix, ThreadIdPrefix>>;
+//   #define APP_LOG(severity) SIMPLELOGGER_LOG(AppLogger, severity)
+template <typename PrefixList, typename CharT = wchar_t>
+class SimpleLoggerT : public BasicSimpleLogger<CharT>
+{
+public:
+
+    SimpleLoggerT(SimpleLoggerBase::Severity severity = SimpleLoggerBase::Severity::kDebug, bool newline = true,
+        const std::source_location& location = std::source_location::current())
+        : BasicSimpleLogger<CharT>(severity, newline, location, PrefixList{})
+    {
+    }
+};
+
+
+// Date & Time prefix (see BasicSimpleLogger::TimestampPrefix).
+struct TimePrefix
+{
+    template <typename CharT>
+    static void Append(std::basic_string<CharT>& message)
+    {
+        BasicSimpleLogger<CharT>::TimestampPrefix(message);
+    }
+};
+
+
+// Thread id prefix: "[id] " (formatted once per thread).
+struct ThreadIdPrefix
+{
+    template <typename CharT>
+    static void Append(std::basic_string<CharT>& message)
+    {
+        thread_local const std::basic_string<CharT> text{ [] {
+            std::basic_ostringstream<CharT> text_stream{};
+            text_stream << static_cast<CharT>('[') << std::this_thread::get_id() << static_cast<CharT>(']') << static_cast<CharT>(' ');
+            return text_stream.str();
+        }() };
+
+        message += text;
+    }
+};
+
+// __Compile-time prefix pipeline
 
 #endif
\ No newline at end of file